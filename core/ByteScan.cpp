@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <core/ByteScan.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define OBL_BYTESCAN_AVX2
+#endif
+
+namespace Obelix {
+
+namespace {
+
+constexpr bool is_blank(char ch, bool include_newlines)
+{
+    switch (ch) {
+    case ' ':
+    case '\t':
+    case '\v':
+    case '\f':
+        return true;
+    case '\n':
+    case '\r':
+        return include_newlines;
+    default:
+        return false;
+    }
+}
+
+size_t span_of_scalar(std::string_view text, size_t pos, std::array<uint8_t, 256> const& table)
+{
+    while (pos < text.length() && table[static_cast<unsigned char>(text[pos])])
+        ++pos;
+    return pos;
+}
+
+size_t whitespace_span_scalar(std::string_view text, size_t pos, bool include_newlines)
+{
+    while (pos < text.length() && is_blank(text[pos], include_newlines))
+        ++pos;
+    return pos;
+}
+
+#if defined(__SSE2__)
+
+size_t whitespace_span_sse2(std::string_view text, bool include_newlines)
+{
+    auto const space = _mm_set1_epi8(' ');
+    auto const tab = _mm_set1_epi8('\t');
+    auto const vtab = _mm_set1_epi8('\v');
+    auto const formfeed = _mm_set1_epi8('\f');
+    auto const lf = _mm_set1_epi8(include_newlines ? '\n' : ' ');
+    auto const cr = _mm_set1_epi8(include_newlines ? '\r' : ' ');
+    size_t pos = 0;
+    for (; pos + 16 <= text.length(); pos += 16) {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text.data() + pos));
+        auto blanks = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(block, space), _mm_cmpeq_epi8(block, tab)),
+                _mm_or_si128(_mm_cmpeq_epi8(block, vtab), _mm_cmpeq_epi8(block, formfeed))),
+            _mm_or_si128(_mm_cmpeq_epi8(block, lf), _mm_cmpeq_epi8(block, cr)));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(blanks));
+        if (mask != 0xFFFF)
+            return pos + __builtin_ctz(~mask);
+    }
+    return whitespace_span_scalar(text, pos, include_newlines);
+}
+
+size_t find_any_of_sse2(std::string_view text, std::string_view needles)
+{
+    __m128i n[4];
+    for (auto ix = 0u; ix < 4; ++ix)
+        n[ix] = _mm_set1_epi8(needles[(ix < needles.length()) ? ix : 0]);
+    size_t pos = 0;
+    for (; pos + 16 <= text.length(); pos += 16) {
+        auto block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(text.data() + pos));
+        auto hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, n[0]), _mm_cmpeq_epi8(block, n[1])),
+            _mm_or_si128(_mm_cmpeq_epi8(block, n[2]), _mm_cmpeq_epi8(block, n[3])));
+        if (auto mask = static_cast<unsigned>(_mm_movemask_epi8(hits)); mask != 0)
+            return pos + __builtin_ctz(mask);
+    }
+    auto ret = text.substr(pos).find_first_of(needles);
+    return (ret != std::string_view::npos) ? pos + ret : ret;
+}
+
+#endif
+
+#if defined(OBL_BYTESCAN_AVX2)
+
+__attribute__((target("avx2"))) size_t whitespace_span_avx2(std::string_view text, bool include_newlines)
+{
+    auto const space = _mm256_set1_epi8(' ');
+    auto const tab = _mm256_set1_epi8('\t');
+    auto const vtab = _mm256_set1_epi8('\v');
+    auto const formfeed = _mm256_set1_epi8('\f');
+    auto const lf = _mm256_set1_epi8(include_newlines ? '\n' : ' ');
+    auto const cr = _mm256_set1_epi8(include_newlines ? '\r' : ' ');
+    size_t pos = 0;
+    for (; pos + 32 <= text.length(); pos += 32) {
+        auto block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(text.data() + pos));
+        auto blanks = _mm256_or_si256(
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(block, space), _mm256_cmpeq_epi8(block, tab)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(block, vtab), _mm256_cmpeq_epi8(block, formfeed))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, lf), _mm256_cmpeq_epi8(block, cr)));
+        auto mask = static_cast<unsigned>(_mm256_movemask_epi8(blanks));
+        if (mask != 0xFFFFFFFF)
+            return pos + __builtin_ctz(~mask);
+    }
+    return whitespace_span_scalar(text, pos, include_newlines);
+}
+
+__attribute__((target("avx2"))) size_t find_any_of_avx2(std::string_view text, std::string_view needles)
+{
+    __m256i n[4];
+    for (auto ix = 0u; ix < 4; ++ix)
+        n[ix] = _mm256_set1_epi8(needles[(ix < needles.length()) ? ix : 0]);
+    size_t pos = 0;
+    for (; pos + 32 <= text.length(); pos += 32) {
+        auto block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(text.data() + pos));
+        auto hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, n[0]), _mm256_cmpeq_epi8(block, n[1])),
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, n[2]), _mm256_cmpeq_epi8(block, n[3])));
+        if (auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hits)); mask != 0)
+            return pos + __builtin_ctz(mask);
+    }
+    auto ret = text.substr(pos).find_first_of(needles);
+    return (ret != std::string_view::npos) ? pos + ret : ret;
+}
+
+/*
+ * Looks up the masks for the low and the high nibble of every byte with a
+ * shuffle. A byte is in the class if the two masks have a bit in common.
+ */
+__attribute__((target("avx2"))) size_t span_of_avx2(std::string_view text, size_t pos, std::array<uint8_t, 16> const& low, std::array<uint8_t, 16> const& high, std::array<uint8_t, 256> const& table)
+{
+    auto const low_masks = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(low.data())));
+    auto const high_masks = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const*>(high.data())));
+    auto const nibble = _mm256_set1_epi8(0x0F);
+    auto const zero = _mm256_setzero_si256();
+    for (; pos + 32 <= text.length(); pos += 32) {
+        auto block = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(text.data() + pos));
+        auto lows = _mm256_shuffle_epi8(low_masks, _mm256_and_si256(block, nibble));
+        auto highs = _mm256_shuffle_epi8(high_masks, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+        auto misses = _mm256_cmpeq_epi8(_mm256_and_si256(lows, highs), zero);
+        if (auto mask = static_cast<unsigned>(_mm256_movemask_epi8(misses)); mask != 0)
+            return pos + __builtin_ctz(mask);
+    }
+    return span_of_scalar(text, pos, table);
+}
+
+bool has_avx2()
+{
+    static bool const s_has_avx2 = __builtin_cpu_supports("avx2");
+    return s_has_avx2;
+}
+
+#endif
+
+}
+
+size_t whitespace_span(std::string_view text, bool include_newlines)
+{
+    /*
+     * Most whitespace runs are a single space, or a newline followed by
+     * a few spaces of indentation. Don't bother setting up vector registers
+     * for those.
+     */
+    if (text.empty() || !is_blank(text[0], include_newlines))
+        return 0;
+    if (text.length() < 2 || !is_blank(text[1], include_newlines))
+        return 1;
+#if defined(OBL_BYTESCAN_AVX2)
+    if (text.length() >= 32 && has_avx2())
+        return whitespace_span_avx2(text, include_newlines);
+#endif
+#if defined(__SSE2__)
+    return whitespace_span_sse2(text, include_newlines);
+#else
+    return whitespace_span_scalar(text, 0, include_newlines);
+#endif
+}
+
+size_t find_any_of(std::string_view text, std::string_view needles)
+{
+    if (text.empty() || needles.empty() || needles.length() > 4)
+        return text.find_first_of(needles);
+    if (needles.length() == 1) {
+        auto ret = memchr(text.data(), needles[0], text.length());
+        return (ret != nullptr) ? static_cast<char const*>(ret) - text.data() : std::string_view::npos;
+    }
+#if defined(OBL_BYTESCAN_AVX2)
+    if (text.length() >= 32 && has_avx2())
+        return find_any_of_avx2(text, needles);
+#endif
+#if defined(__SSE2__)
+    return find_any_of_sse2(text, needles);
+#else
+    return text.find_first_of(needles);
+#endif
+}
+
+ByteClass::ByteClass(std::bitset<256> const& bytes)
+{
+    for (auto ix = 0u; ix < 256; ++ix)
+        m_table[ix] = bytes[ix];
+    build();
+}
+
+ByteClass::ByteClass(std::string_view bytes)
+{
+    for (auto ch : bytes)
+        m_table[static_cast<unsigned char>(ch)] = 1;
+    build();
+}
+
+std::bitset<256> ByteClass::bytes() const
+{
+    std::bitset<256> ret;
+    for (auto ix = 0u; ix < 256; ++ix)
+        ret[ix] = m_table[ix] != 0;
+    return ret;
+}
+
+ByteClass ByteClass::complement() const
+{
+    return ByteClass(~bytes());
+}
+
+/*
+ * Every high nibble selects a set of low nibbles. Each distinct non-empty
+ * set gets a bit, which is the mask of the high nibbles selecting it and
+ * is set in the masks of the low nibbles in it. That only works if there
+ * are at most eight distinct sets.
+ */
+void ByteClass::build()
+{
+    std::array<uint16_t, 8> sets {};
+    size_t count = 0;
+    m_low = {};
+    m_high = {};
+    m_nibbles = false;
+    for (auto high = 0u; high < 16; ++high) {
+        uint16_t set = 0;
+        for (auto low = 0u; low < 16; ++low) {
+            if (m_table[high << 4 | low])
+                set |= 1 << low;
+        }
+        if (set == 0)
+            continue;
+        auto bit = static_cast<size_t>(std::find(sets.begin(), sets.begin() + count, set) - sets.begin());
+        if (bit == count) {
+            if (count == sets.size())
+                return;
+            sets[count++] = set;
+        }
+        m_high[high] = 1 << bit;
+        for (auto low = 0u; low < 16; ++low) {
+            if (set & (1 << low))
+                m_low[low] |= 1 << bit;
+        }
+    }
+    m_nibbles = true;
+}
+
+size_t span_of(std::string_view text, ByteClass const& bytes)
+{
+    /*
+     * Runs of identifier characters and the like are mostly short, so the
+     * first bytes are checked one at a time.
+     */
+    size_t pos = 0;
+    for (; pos < text.length() && pos < 8; ++pos) {
+        if (!bytes.m_table[static_cast<unsigned char>(text[pos])])
+            return pos;
+    }
+#if defined(OBL_BYTESCAN_AVX2)
+    if (bytes.m_nibbles && text.length() - pos >= 32 && has_avx2())
+        return span_of_avx2(text, pos, bytes.m_low, bytes.m_high, bytes.m_table);
+#endif
+    return span_of_scalar(text, pos, bytes.m_table);
+}
+
+}
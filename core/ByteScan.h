@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace Obelix {
+
+/**
+ * Bulk byte scanning primitives for the lexer hot paths. They look at 16 or
+ * 32 bytes at a time using SSE2 or AVX2 when the CPU has them, and fall
+ * back to a plain loop otherwise. All of them only look at the bytes inside
+ * the string_view they are given.
+ */
+
+/**
+ * Returns the length of the run of whitespace, as defined by isspace() in
+ * the C locale, at the start of text. If include_newlines is false, the run
+ * stops at the first '\n' or '\r'.
+ */
+[[nodiscard]] size_t whitespace_span(std::string_view text, bool include_newlines = true);
+
+/**
+ * Returns the position of the first byte in text that is one of the bytes
+ * in needles, or std::string_view::npos if there is none. Up to four
+ * needles are searched for in bulk; with more than that this is
+ * std::string_view::find_first_of().
+ */
+[[nodiscard]] size_t find_any_of(std::string_view text, std::string_view needles);
+
+/**
+ * A set of bytes to scan for with span_of(). Building one works out the
+ * lookup tables for the vectorized scan, so it should be built once, for
+ * example when a scanner is configured, and not for every scan.
+ */
+class ByteClass {
+public:
+    ByteClass() = default;
+    explicit ByteClass(std::bitset<256> const& bytes);
+    explicit ByteClass(std::string_view bytes);
+
+    /**
+     * The class of the bytes for which predicate, called with the values 0
+     * to 255 like the functions from <cctype>, returns true.
+     */
+    template<typename Predicate>
+    static ByteClass matching(Predicate predicate)
+    {
+        std::bitset<256> bytes;
+        for (auto ix = 0u; ix < 256; ++ix)
+            bytes[ix] = static_cast<bool>(predicate(static_cast<int>(ix)));
+        return ByteClass(bytes);
+    }
+
+    [[nodiscard]] bool contains(unsigned char ch) const { return m_table[ch] != 0; }
+    [[nodiscard]] std::bitset<256> bytes() const;
+    [[nodiscard]] ByteClass complement() const;
+
+private:
+    friend size_t span_of(std::string_view, ByteClass const&);
+    void build();
+
+    std::array<uint8_t, 256> m_table {};
+    // A byte is in the class if the masks for its low and its high nibble
+    // have a bit in common. Only set up if m_nibbles is.
+    std::array<uint8_t, 16> m_low {};
+    std::array<uint8_t, 16> m_high {};
+    bool m_nibbles { false };
+};
+
+/**
+ * Returns the length of the run of bytes in the class at the start of text.
+ * The run is scanned in bulk if the class can be expressed as two lookup
+ * tables indexed by nibble, which is the case for the character classes a
+ * lexer typically uses, and with a plain loop otherwise.
+ */
+[[nodiscard]] size_t span_of(std::string_view text, ByteClass const& bytes);
+
+}
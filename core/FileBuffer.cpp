@@ -5,8 +5,13 @@
  */
 
 #include <cerrno>
+#include <cstring>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
 
 #include <core/FileBuffer.h>
 #include <core/Logging.h>
@@ -45,13 +50,169 @@ ErrorOr<fs::path, SystemError> SimpleBufferLocator::locate(std::string const& fi
     return file_name;
 }
 
+SearchPathBufferLocator::SearchPathBufferLocator(std::vector<fs::path> directories, bool obl_dir, bool watch)
+    : m_directories(std::move(directories))
+    , m_watch(watch)
+{
+    if (obl_dir) {
+        fs::path obldir = getenv("OBL_DIR") ? getenv("OBL_DIR") : "";
+        if (obldir.empty())
+            obldir = "/usr/share/obelix";
+        m_directories.push_back(obldir / "share");
+        m_directories.push_back(obldir);
+    }
+}
+
+SearchPathBufferLocator::~SearchPathBufferLocator()
+{
+    unwatch();
+}
+
+ErrorOr<fs::path, SystemError> SearchPathBufferLocator::locate(std::string const& file_name) const
+{
+    fs::path path = file_name;
+    if (path.is_absolute()) {
+        if (auto exists = check_existence(path); exists.is_error())
+            return exists.error();
+        return path;
+    }
+    std::lock_guard lock(m_mutex);
+    if (m_built && changed()) {
+        debug(stringbuffer, "Search path changed. Rebuilding the index");
+        m_built = false;
+    }
+    if (!m_built)
+        build();
+    auto it = m_index.find(path.lexically_normal().generic_string());
+    if (it == m_index.end())
+        return SystemError { ErrorCode::NoSuchFile, "File '{}' not found in search path", file_name };
+    return it->second;
+}
+
+void SearchPathBufferLocator::invalidate()
+{
+    std::lock_guard lock(m_mutex);
+    m_built = false;
+}
+
+/*
+ * Scan the directories in order, so that a name maps to the file in the
+ * first directory that has it. Every directory scanned is watched,
+ * subdirectories included, since inotify doesn't watch recursively.
+ */
+void SearchPathBufferLocator::build() const
+{
+    unwatch();
+#ifdef __linux__
+    if (m_watch) {
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotify < 0)
+            debug(stringbuffer, "Could not initialize inotify: {}. Search path is not watched", strerror(errno));
+    }
+#endif
+    auto watch = [this](fs::path const& dir) {
+#ifdef __linux__
+        if (m_inotify < 0)
+            return;
+        if (inotify_add_watch(m_inotify, dir.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+            debug(stringbuffer, "Could not watch '{}': {}. Search path is not watched", dir, strerror(errno));
+            unwatch();
+        }
+#endif
+    };
+
+    m_index.clear();
+    for (auto const& directory : m_directories) {
+        std::error_code ec;
+        if (!fs::is_directory(directory, ec))
+            continue;
+        watch(directory);
+        for (auto it = fs::recursive_directory_iterator(directory, fs::directory_options::skip_permission_denied, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+            if (it->is_directory(ec)) {
+                watch(it->path());
+            } else if (it->is_regular_file(ec)) {
+                m_index.emplace(it->path().lexically_relative(directory).generic_string(), it->path());
+            }
+        }
+    }
+    debug(stringbuffer, "Indexed {} files in {} directories", m_index.size(), m_directories.size());
+    m_built = true;
+}
+
+/*
+ * Drain the inotify events. Any event means the index may be stale.
+ */
+bool SearchPathBufferLocator::changed() const
+{
+#ifdef __linux__
+    if (m_inotify < 0)
+        return false;
+    alignas(inotify_event) char events[4096];
+    auto ret = false;
+    while (::read(m_inotify, events, sizeof(events)) > 0)
+        ret = true;
+    return ret;
+#else
+    return false;
+#endif
+}
+
+void SearchPathBufferLocator::unwatch() const
+{
+    if (m_inotify >= 0)
+        ::close(m_inotify);
+    m_inotify = -1;
+}
+
 FileBuffer::FileBuffer(fs::path path, char const* text, bool take_ownership)
     : StringBuffer(text, take_ownership)
     , m_path(std::move(path))
 {
 }
 
-ErrorOr<std::shared_ptr<FileBuffer>, SystemError> FileBuffer::from_file(std::string const& file_name, BufferLocator* locator)
+FileBuffer::FileBuffer(fs::path path, std::string_view text, std::shared_ptr<void const> storage, bool mapped)
+    : StringBuffer(text, std::move(storage))
+    , m_path(std::move(path))
+    , m_mapped(mapped)
+{
+}
+
+/*
+ * Map size bytes of the file. Code scanning the text may rely on a NUL
+ * following it. The rest of the last page of a mapping reads as zeroes,
+ * but if the size is a multiple of the page size there is no rest. In that
+ * case an extra, anonymous, page is reserved and the file is mapped over
+ * the start of the reservation.
+ */
+static std::shared_ptr<void const> map_file(int fh, size_t size, FileBuffer::Options const& options)
+{
+    auto page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto length = size;
+    auto flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (options.populate)
+        flags |= MAP_POPULATE;
+#endif
+    void* addr;
+    if (size % page_size == 0) {
+        length = size + page_size;
+        auto reservation = mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (reservation == MAP_FAILED)
+            return nullptr;
+        addr = mmap(reservation, size, PROT_READ, flags | MAP_FIXED, fh, 0);
+        if (addr == MAP_FAILED)
+            munmap(reservation, length);
+    } else {
+        addr = mmap(nullptr, size, PROT_READ, flags, fh, 0);
+    }
+    if (addr == MAP_FAILED)
+        return nullptr;
+    if (options.sequential)
+        madvise(addr, size, MADV_SEQUENTIAL);
+    return { addr, [length](void const* p) { munmap(const_cast<void*>(p), length); } };
+}
+
+ErrorOr<std::shared_ptr<FileBuffer>, SystemError> FileBuffer::from_file(std::string const& file_name, BufferLocator* locator, Options const& options)
 {
     static SimpleBufferLocator s_simple_locator;
     if (locator == nullptr)
@@ -59,8 +220,11 @@ ErrorOr<std::shared_ptr<FileBuffer>, SystemError> FileBuffer::from_file(std::str
     auto file_name_or_error = locator->locate(file_name);
     if (file_name_or_error.is_error())
         return file_name_or_error.error();
-    auto full_file_name = file_name_or_error.value();
+    return load(file_name_or_error.value(), options);
+}
 
+ErrorOr<std::shared_ptr<FileBuffer>, SystemError> FileBuffer::load(fs::path const& full_file_name, Options const& options)
+{
     auto fh = ::open(full_file_name.c_str(), O_RDONLY);
     auto file_closer = ScopeGuard([fh]() {
         if (fh > 0)
@@ -81,12 +245,20 @@ ErrorOr<std::shared_ptr<FileBuffer>, SystemError> FileBuffer::from_file(std::str
         return SystemError { ErrorCode::PathIsDirectory, "Path '{}' is a directory, not a file", full_file_name };
 
     auto size = sb.st_size;
+    if (size > 0 && static_cast<size_t>(size) >= options.map_threshold) {
+        if (auto storage = map_file(fh, size, options); storage != nullptr) {
+            auto text = std::string_view(static_cast<char const*>(storage.get()), size);
+            return std::make_shared<FileBuffer>(full_file_name, text, std::move(storage), true);
+        }
+        debug(stringbuffer, "Could not map '{}': {}. Reading it instead", full_file_name, strerror(errno));
+    }
     auto buffer = new char[size + 1];
+    auto storage = std::shared_ptr<void const>(buffer, [](void const* p) { delete[] static_cast<char const*>(p); });
     if (auto rc = ::read(fh, (void*)buffer, size); rc < size) {
         return SystemError { ErrorCode::IOError, "Error reading '{}'", full_file_name };
     }
     buffer[size] = '\0';
-    return std::make_shared<FileBuffer>(full_file_name, buffer, true);
+    return std::make_shared<FileBuffer>(full_file_name, std::string_view(buffer, size), std::move(storage), false);
 }
 
 }
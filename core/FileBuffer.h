@@ -7,7 +7,11 @@
 #pragma once
 
 #include <filesystem>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include <core/Error.h>
 #include <core/ScopeGuard.h>
@@ -40,14 +44,81 @@ public:
     [[nodiscard]] ErrorOr<fs::path, SystemError> locate(std::string const&) const override;
 };
 
+/**
+ * Locates files in a list of directories, optionally followed by
+ * $OBL_DIR/share and $OBL_DIR, where OBL_DIR defaults to /usr/share/obelix
+ * like it does for the Resolver. The first directory holding a file wins.
+ * Names are paths relative to the directories; absolute paths are only
+ * checked for existence.
+ *
+ * The directories are scanned once, into an index from names to paths, so
+ * locating a file doesn't probe the directories. If watch is set, the
+ * scanned directories are watched with inotify, and the index is rebuilt
+ * after a change; checking for changes is a single read() per locate().
+ * Otherwise, or if the directories can't be watched, call invalidate()
+ * after files were added or removed.
+ */
+class SearchPathBufferLocator : public BufferLocator {
+public:
+    explicit SearchPathBufferLocator(std::vector<fs::path> directories, bool obl_dir = true, bool watch = true);
+    ~SearchPathBufferLocator() override;
+    [[nodiscard]] ErrorOr<fs::path, SystemError> locate(std::string const&) const override;
+    void invalidate();
+
+    [[nodiscard]] std::vector<fs::path> const& directories() const { return m_directories; }
+
+private:
+    void build() const;
+    [[nodiscard]] bool changed() const;
+    void unwatch() const;
+
+    std::vector<fs::path> m_directories;
+    bool m_watch;
+    mutable std::mutex m_mutex;
+    mutable bool m_built { false };
+    mutable std::unordered_map<std::string, fs::path> m_index {};
+    mutable int m_inotify { -1 };
+};
+
+/**
+ * How FileBuffer::from_file() loads a file. Files of at least map_threshold
+ * bytes are memory mapped instead of read into the heap, so that processes
+ * reading the same file share its pages in the page cache. The default never
+ * maps.
+ */
+struct FileBufferOptions {
+    size_t map_threshold { std::numeric_limits<size_t>::max() };
+    bool sequential { true }; // madvise(MADV_SEQUENTIAL) the mapping
+    bool populate { false };  // Read the whole file when it is mapped
+};
+
 class FileBuffer : public StringBuffer {
 public:
+    using Options = FileBufferOptions;
+
+    /**
+     * A map_threshold that pays off: below it, setting up and tearing down
+     * the mapping costs more than copying the file.
+     */
+    static constexpr size_t MapThreshold = 256 * 1024;
+
     FileBuffer(fs::path, char const*, bool = false);
-    static ErrorOr<std::shared_ptr<FileBuffer>, SystemError> from_file(std::string const&, BufferLocator* = nullptr);
+    FileBuffer(fs::path, std::string_view, std::shared_ptr<void const>, bool mapped);
+    static ErrorOr<std::shared_ptr<FileBuffer>, SystemError> from_file(std::string const&, BufferLocator* = nullptr, Options const& = {});
+
+    /**
+     * Loads the file at path, which was already located. The text is kept
+     * alive by storage(), so buffers over the same text can be created
+     * without copying it.
+     */
+    static ErrorOr<std::shared_ptr<FileBuffer>, SystemError> load(fs::path const& path, Options const& = {});
 
     [[nodiscard]] fs::path const& file_path() const { return m_path; }
+    [[nodiscard]] bool mapped() const { return m_mapped; }
+
 private:
     fs::path m_path;
+    bool m_mapped { false };
 };
 
 }
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+
+#include <core/FileLoader.h>
+#include <core/Logging.h>
+
+namespace Obelix {
+
+extern_logging_category(stringbuffer);
+
+FileLoader::FileLoader(std::vector<std::string> file_names, BufferLocator* locator, FileBuffer::Options const& options, size_t threads)
+    : m_file_names(std::move(file_names))
+    , m_locator(locator)
+    , m_options(options)
+{
+    threads = std::clamp(threads, static_cast<size_t>(1), std::max(m_file_names.size(), static_cast<size_t>(1)));
+    debug(stringbuffer, "Loading {} files on {} threads", m_file_names.size(), threads);
+    for (auto ix = 0u; ix < threads; ++ix)
+        m_threads.emplace_back([this]() { run(); });
+}
+
+FileLoader::~FileLoader()
+{
+    m_next_file = m_file_names.size();
+    for (auto& thread : m_threads)
+        thread.join();
+}
+
+void FileLoader::run()
+{
+    for (auto ix = m_next_file++; ix < m_file_names.size(); ix = m_next_file++) {
+        auto buffer = FileBuffer::from_file(m_file_names[ix], m_locator, m_options);
+        std::lock_guard lock(m_mutex);
+        m_loaded.push_back({ ix, m_file_names[ix], std::move(buffer) });
+        m_condition.notify_one();
+    }
+}
+
+std::optional<FileLoader::Loaded> FileLoader::next()
+{
+    std::unique_lock lock(m_mutex);
+    if (m_handed_out >= m_file_names.size())
+        return {};
+    m_condition.wait(lock, [this]() { return !m_loaded.empty(); });
+    auto ret = std::move(m_loaded.front());
+    m_loaded.pop_front();
+    ++m_handed_out;
+    return ret;
+}
+
+std::vector<FileLoader::Loaded> FileLoader::wait()
+{
+    std::vector<Loaded> ret;
+    for (auto loaded = next(); loaded.has_value(); loaded = next())
+        ret.push_back(std::move(loaded.value()));
+    std::sort(ret.begin(), ret.end(), [](Loaded const& a, Loaded const& b) { return a.index < b.index; });
+    return ret;
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include <core/FileBuffer.h>
+
+namespace Obelix {
+
+/**
+ * Loads a batch of files on a pool of threads, so that opening and reading
+ * them overlaps. next() hands out the results in the order the loads
+ * complete, so a driver can start lexing the first file that is in while
+ * the others are still being read.
+ *
+ * The locator is shared by the threads, so its locate() must be thread
+ * safe. SimpleBufferLocator's is.
+ */
+class FileLoader {
+public:
+    using Result = ErrorOr<std::shared_ptr<FileBuffer>, SystemError>;
+
+    struct Loaded {
+        size_t index; // In the list of file names the loader was given
+        std::string file_name;
+        Result buffer;
+    };
+
+    /**
+     * Loading files is waiting for I/O, so this doesn't depend on the
+     * number of cores.
+     */
+    static constexpr size_t DefaultThreads = 8;
+
+    explicit FileLoader(std::vector<std::string> file_names, BufferLocator* = nullptr, FileBuffer::Options const& = {}, size_t threads = DefaultThreads);
+    FileLoader(FileLoader const&) = delete;
+
+    /**
+     * Files that weren't started yet are skipped. Waits for the loads that
+     * are in progress.
+     */
+    ~FileLoader();
+
+    /**
+     * The next file that finished loading, waiting for one if needed.
+     * Returns an empty optional once all files were handed out.
+     */
+    std::optional<Loaded> next();
+
+    /**
+     * Waits for all files that weren't handed out by next() yet, and
+     * returns them in the order they were given in.
+     */
+    std::vector<Loaded> wait();
+
+    [[nodiscard]] size_t size() const { return m_file_names.size(); }
+
+private:
+    void run();
+
+    std::vector<std::string> m_file_names;
+    BufferLocator* m_locator;
+    FileBuffer::Options m_options;
+    std::atomic<size_t> m_next_file { 0 };
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Loaded> m_loaded {};
+    size_t m_handed_out { 0 };
+    std::vector<std::thread> m_threads {};
+};
+
+}
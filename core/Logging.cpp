@@ -8,6 +8,8 @@
 // Created by Jan de Visser on 2021-10-04.
 //
 
+#include <algorithm>
+
 #include <core/Logging.h>
 #include <ctime>
 #include <mutex>
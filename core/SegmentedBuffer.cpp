@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+
+#include <core/SegmentedBuffer.h>
+
+namespace Obelix {
+
+SegmentedBuffer::SegmentedBuffer(std::vector<std::string_view> segments)
+{
+    for (auto const& segment : segments) {
+        if (!segment.empty())
+            m_segments.push_back(segment);
+    }
+    start();
+}
+
+SegmentedBuffer::SegmentedBuffer(std::vector<std::string> const& lines, std::string separator)
+    : m_separator(std::move(separator))
+{
+    add_lines(lines);
+    start();
+}
+
+SegmentedBuffer::SegmentedBuffer(std::vector<std::string>&& lines, std::string separator)
+    : m_owned(std::move(lines))
+    , m_separator(std::move(separator))
+{
+    add_lines(m_owned);
+    start();
+}
+
+void SegmentedBuffer::add_lines(std::vector<std::string> const& lines)
+{
+    for (auto ix = 0u; ix < lines.size(); ++ix) {
+        if (ix > 0 && !m_separator.empty())
+            m_segments.emplace_back(m_separator);
+        if (!lines[ix].empty())
+            m_segments.emplace_back(lines[ix]);
+    }
+}
+
+void SegmentedBuffer::start()
+{
+    for (auto const& segment : m_segments) {
+        m_starts.push_back(m_length);
+        line_index().append(segment);
+        m_length += segment.length();
+    }
+    if (!m_segments.empty())
+        window(m_segments.front(), 0);
+}
+
+std::string SegmentedBuffer::str() const
+{
+    std::string ret;
+    ret.reserve(m_length);
+    for (auto const& segment : m_segments)
+        ret += segment;
+    return ret;
+}
+
+size_t SegmentedBuffer::segment_of(size_t offset) const
+{
+    auto it = std::upper_bound(m_starts.begin(), m_starts.end(), offset);
+    return static_cast<size_t>(it - m_starts.begin()) - 1;
+}
+
+/*
+ * If the text from the mark, or from the held offset if that comes first,
+ * up to the end of what is needed lies in one segment, that segment is the
+ * new window. Otherwise just that text is copied into scratch space. Once
+ * the mark has moved on into the next segment, the window is that segment
+ * again.
+ */
+bool SegmentedBuffer::underflow(size_t num)
+{
+    if (!more())
+        return false;
+    auto keep = std::min(base() + mark(), std::max(held(), base()));
+    auto end = std::min(offset() + num, m_length);
+    auto first = segment_of(keep);
+    if (end <= m_starts[first] + m_segments[first].length()) {
+        m_scratch_window = false;
+        window(m_segments[first], m_starts[first]);
+    } else {
+        m_scratch.clear();
+        for (auto ix = first; keep + m_scratch.length() < end; ++ix) {
+            auto segment = m_segments[ix];
+            if (ix == first)
+                segment = segment.substr(keep - m_starts[first]);
+            m_scratch.append(segment.substr(0, end - keep - m_scratch.length()));
+        }
+        m_scratch_window = true;
+        window(m_scratch, keep);
+    }
+    return offset() + num <= m_length;
+}
+
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <core/StringBuffer.h>
+
+namespace Obelix {
+
+/**
+ * A StringBuffer over text that is made up of segments, for example the
+ * lines of a document in an editor, without joining them. buffer() is a
+ * window on the text: as long as the mark and the position stay in one
+ * segment, it is that segment. Only when a read crosses into the next
+ * segment is the text from the mark on copied into scratch space, up to
+ * where the read needs it.
+ *
+ * The segments are referenced, not copied, unless they are passed as
+ * strings to be owned. Like the text of a StringBuffer assigned a
+ * std::string_view, referenced segments must outlive the buffer and its
+ * tokens.
+ */
+class SegmentedBuffer : public StringBuffer {
+public:
+    explicit SegmentedBuffer(std::vector<std::string_view> segments);
+
+    /**
+     * A buffer over the lines, with separator between every two lines.
+     * The lines are referenced; the separator is copied.
+     */
+    SegmentedBuffer(std::vector<std::string> const& lines, std::string separator);
+    SegmentedBuffer(std::vector<std::string>&& lines, std::string separator);
+    SegmentedBuffer(SegmentedBuffer const&) = delete;
+
+    [[nodiscard]] std::string str() const override;
+    [[nodiscard]] bool more() const override { return base() + buffer().length() < m_length; }
+    [[nodiscard]] bool transient() const override { return m_scratch_window; }
+    [[nodiscard]] size_t length() const { return m_length; }
+    [[nodiscard]] size_t segments() const { return m_segments.size(); }
+
+protected:
+    bool underflow(size_t) override;
+
+private:
+    void add_lines(std::vector<std::string> const& lines);
+    void start();
+    [[nodiscard]] size_t segment_of(size_t offset) const;
+
+    std::vector<std::string> m_owned {};
+    std::string m_separator {};
+    std::vector<std::string_view> m_segments {};
+    std::vector<size_t> m_starts {}; // Offset of every segment in the text
+    size_t m_length { 0 };
+    std::string m_scratch {};
+    bool m_scratch_window { false };
+};
+
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cerrno>
+#include <sys/stat.h>
+
+#include <core/Logging.h>
+#include <core/SourceCache.h>
+
+namespace Obelix {
+
+extern_logging_category(stringbuffer);
+
+SourceCache::Identity SourceCache::Identity::of(struct stat const& sb)
+{
+#ifdef __APPLE__
+    return { sb.st_dev, sb.st_ino, sb.st_size, sb.st_mtimespec };
+#else
+    return { sb.st_dev, sb.st_ino, sb.st_size, sb.st_mtim };
+#endif
+}
+
+bool SourceCache::Identity::operator==(Identity const& other) const
+{
+    return device == other.device && inode == other.inode && size == other.size
+        && modified.tv_sec == other.modified.tv_sec && modified.tv_nsec == other.modified.tv_nsec;
+}
+
+std::shared_ptr<FileBuffer> SourceCache::Entry::buffer() const
+{
+    return std::make_shared<FileBuffer>(path, text, storage, mapped);
+}
+
+SourceCache::SourceCache(size_t budget)
+    : m_budget(budget)
+{
+}
+
+SourceCache& SourceCache::get_cache() noexcept
+{
+    static SourceCache s_cache;
+    return s_cache;
+}
+
+ErrorOr<std::shared_ptr<FileBuffer>, SystemError> SourceCache::get(std::string const& file_name, BufferLocator* locator, FileBuffer::Options const& options)
+{
+    fs::path path = file_name;
+    if (locator != nullptr)
+        path = TRY(locator->locate(file_name));
+
+    struct stat sb;
+    if (::stat(path.c_str(), &sb) < 0) {
+        switch (errno) {
+        case ENOENT:
+            return SystemError { ErrorCode::NoSuchFile, "File '{}' does not exist", path };
+        default:
+            return SystemError { ErrorCode::IOError, "Error stat-ing file '{}'", path };
+        }
+    }
+    if (S_ISDIR(sb.st_mode))
+        return SystemError { ErrorCode::PathIsDirectory, "Path '{}' is a directory, not a file", path };
+    auto identity = Identity::of(sb);
+    auto key = path.string();
+
+    {
+        std::lock_guard lock(m_mutex);
+        if (auto it = m_entries.find(key); it != m_entries.end()) {
+            if (it->second->identity == identity) {
+                ++m_statistics.hits;
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                return it->second->buffer();
+            }
+            debug(stringbuffer, "'{}' changed since it was cached", key);
+            drop(it->second);
+        }
+        ++m_statistics.misses;
+    }
+
+    /*
+     * The file is loaded after the stat(). If it changes in between, the
+     * text is newer than the identity, and the next get() loads it again.
+     */
+    auto buffer = TRY(FileBuffer::load(path, options));
+    std::lock_guard lock(m_mutex);
+    if (auto it = m_entries.find(key); it != m_entries.end())
+        drop(it->second);
+    if (buffer->buffer().length() <= m_budget) {
+        m_lru.push_front({ key, identity, buffer->file_path(), buffer->buffer(), buffer->storage(), buffer->mapped() });
+        m_entries[key] = m_lru.begin();
+        m_statistics.bytes += buffer->buffer().length();
+        evict();
+    }
+    return buffer;
+}
+
+void SourceCache::drop(std::list<Entry>::iterator entry)
+{
+    m_statistics.bytes -= entry->text.length();
+    m_entries.erase(entry->key);
+    m_lru.erase(entry);
+}
+
+void SourceCache::evict()
+{
+    while (m_statistics.bytes > m_budget && !m_lru.empty()) {
+        debug(stringbuffer, "Evicting '{}' from the source cache", m_lru.back().key);
+        drop(std::prev(m_lru.end()));
+        ++m_statistics.evictions;
+    }
+}
+
+void SourceCache::invalidate(fs::path const& path)
+{
+    std::lock_guard lock(m_mutex);
+    if (auto it = m_entries.find(path.string()); it != m_entries.end())
+        drop(it->second);
+}
+
+void SourceCache::clear()
+{
+    std::lock_guard lock(m_mutex);
+    m_lru.clear();
+    m_entries.clear();
+    m_statistics.bytes = 0;
+}
+
+void SourceCache::budget(size_t budget)
+{
+    std::lock_guard lock(m_mutex);
+    m_budget = budget;
+    evict();
+}
+
+size_t SourceCache::budget() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_budget;
+}
+
+SourceCacheStatistics SourceCache::statistics() const
+{
+    std::lock_guard lock(m_mutex);
+    auto ret = m_statistics;
+    ret.entries = m_entries.size();
+    return ret;
+}
+
+}
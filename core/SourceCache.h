@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <sys/stat.h>
+#include <unordered_map>
+
+#include <core/FileBuffer.h>
+
+namespace Obelix {
+
+struct SourceCacheStatistics {
+    size_t hits { 0 };
+    size_t misses { 0 };    // Including files that changed since they were cached
+    size_t evictions { 0 }; // Files dropped to stay within the budget
+    size_t entries { 0 };
+    size_t bytes { 0 };
+};
+
+/**
+ * Keeps the text of source files that are read over and over, keyed by
+ * their located path. get() hands out a new FileBuffer for every call, but
+ * all buffers for a file share its text, so a repeat load costs a stat()
+ * and no copy. The stat() revalidates the cached text: if the
+ * modification time, size, or inode of the file changed, it is read again.
+ *
+ * The text of the least recently used files is dropped when the cached
+ * text takes more than the budget. Buffers that were handed out keep their
+ * text alive.
+ */
+class SourceCache {
+public:
+    static constexpr size_t DefaultBudget = 64 * 1024 * 1024;
+
+    explicit SourceCache(size_t budget = DefaultBudget);
+    static SourceCache& get_cache() noexcept;
+
+    /**
+     * A buffer over the text of the file, which is located and loaded like
+     * FileBuffer::from_file() does.
+     */
+    ErrorOr<std::shared_ptr<FileBuffer>, SystemError> get(std::string const& file_name, BufferLocator* = nullptr, FileBuffer::Options const& = {});
+
+    void invalidate(fs::path const&);
+    void clear();
+    void budget(size_t);
+    [[nodiscard]] size_t budget() const;
+    [[nodiscard]] SourceCacheStatistics statistics() const;
+
+private:
+    struct Identity {
+        dev_t device;
+        ino_t inode;
+        off_t size;
+        timespec modified;
+
+        static Identity of(struct stat const&);
+        bool operator==(Identity const&) const;
+    };
+
+    struct Entry {
+        std::string key;
+        Identity identity;
+        fs::path path;
+        std::string_view text;
+        std::shared_ptr<void const> storage;
+        bool mapped;
+
+        [[nodiscard]] std::shared_ptr<FileBuffer> buffer() const;
+    };
+
+    void evict();
+    void drop(std::list<Entry>::iterator);
+
+    mutable std::mutex m_mutex;
+    size_t m_budget;
+    std::list<Entry> m_lru {}; // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_entries {};
+    SourceCacheStatistics m_statistics {};
+};
+
+}
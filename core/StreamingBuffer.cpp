@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <core/Logging.h>
+#include <core/StreamingBuffer.h>
+
+namespace Obelix {
+
+extern_logging_category(stringbuffer);
+
+StreamingBuffer::StreamingBuffer(int fd, size_t window_size)
+    : m_fd(fd)
+    , m_window_size(std::max(window_size, static_cast<size_t>(1)))
+{
+    line_index().append({});
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+    if (m_fd >= 0)
+        ::close(m_fd);
+}
+
+ErrorOr<std::shared_ptr<StreamingBuffer>, SystemError> StreamingBuffer::from_file(std::string const& file_name, BufferLocator* locator, size_t window_size)
+{
+    static SimpleBufferLocator s_simple_locator;
+    if (locator == nullptr)
+        locator = &s_simple_locator;
+    auto file_name_or_error = locator->locate(file_name);
+    if (file_name_or_error.is_error())
+        return file_name_or_error.error();
+    auto full_file_name = file_name_or_error.value();
+
+    auto fh = ::open(full_file_name.c_str(), O_RDONLY);
+    if (fh < 0) {
+        switch (errno) {
+        case ENOENT:
+            return SystemError { ErrorCode::NoSuchFile, "File '{}' does not exist", full_file_name };
+        default:
+            return SystemError { ErrorCode::IOError, "Error opening file '{}'", full_file_name };
+        }
+    }
+    return std::make_shared<StreamingBuffer>(fh, window_size);
+}
+
+/*
+ * Drop the bytes before the mark, or before the held offset if that comes
+ * first, and read until there is a window's worth of input after them and
+ * at least num bytes after the position. The window string keeps its
+ * capacity, so once it has grown to the longest token it isn't
+ * reallocated anymore.
+ */
+bool StreamingBuffer::underflow(size_t num)
+{
+    if (m_at_end)
+        return false;
+    auto keep = std::min(base() + mark(), std::max(held(), base())) - base();
+    m_window.erase(0, keep);
+    auto loaded = m_window.length();
+    auto needed = std::max(m_window_size, position() - keep + num);
+    m_window.resize(needed);
+    while (loaded < needed) {
+        auto rc = ::read(m_fd, m_window.data() + loaded, needed - loaded);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0)
+            log_error("Error reading input: {}. Treating it as the end of the input", strerror(errno));
+        if (rc <= 0) {
+            m_at_end = true;
+            break;
+        }
+        line_index().append(std::string_view(m_window.data() + loaded, static_cast<size_t>(rc)));
+        loaded += static_cast<size_t>(rc);
+    }
+    m_window.resize(loaded);
+    window(m_window, base() + keep);
+    return position() + num <= loaded;
+}
+
+}
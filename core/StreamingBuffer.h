@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <core/Error.h>
+#include <core/FileBuffer.h>
+
+namespace Obelix {
+
+/**
+ * A StringBuffer over input that is read from a file descriptor one window
+ * at a time, for files that don't fit in memory. The bytes from the mark,
+ * or from the held offset if that comes first, are kept loaded; when a read
+ * goes past the end of the window the bytes before them are dropped and
+ * more input is read. Memory use is bounded by the window size plus the
+ * length of the longest token.
+ *
+ * buffer() only holds the current window, and position() is relative to
+ * its start. The text moves when the window does, so the offsets of the
+ * input come from offset() and views into buffer() don't survive a read
+ * past its end. The line index is built while the input is read.
+ */
+class StreamingBuffer : public StringBuffer {
+public:
+    static constexpr size_t DefaultWindowSize = 1024 * 1024;
+
+    /**
+     * A buffer reading from fd, which it closes when it is destroyed.
+     */
+    explicit StreamingBuffer(int fd, size_t window_size = DefaultWindowSize);
+    StreamingBuffer(StreamingBuffer const&) = delete;
+    ~StreamingBuffer() override;
+
+    static ErrorOr<std::shared_ptr<StreamingBuffer>, SystemError> from_file(std::string const&, BufferLocator* = nullptr, size_t window_size = DefaultWindowSize);
+
+    [[nodiscard]] bool more() const override { return !m_at_end; }
+    [[nodiscard]] bool transient() const override { return more(); }
+    [[nodiscard]] size_t window_size() const { return m_window_size; }
+
+protected:
+    bool underflow(size_t) override;
+
+private:
+    int m_fd;
+    size_t m_window_size;
+    std::string m_window {};
+    bool m_at_end { false };
+};
+
+}
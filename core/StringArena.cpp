@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <core/StringArena.h>
+
+namespace Obelix {
+
+std::string_view StringArena::add(std::string_view str)
+{
+    auto ret = allocate(str.length());
+    memcpy(ret, str.data(), str.length());
+    return { ret, str.length() };
+}
+
+char* StringArena::allocate(size_t length)
+{
+    auto needed = length + 1;
+    if (m_blocks.empty() || m_used + needed > m_blocks.back().size) {
+        auto spare = std::find_if(m_spare.rbegin(), m_spare.rend(), [needed](Block const& block) {
+            return block.size >= needed;
+        });
+        if (spare != m_spare.rend()) {
+            m_blocks.push_back(std::move(*spare));
+            m_spare.erase(std::next(spare).base());
+        } else {
+            auto size = std::max(BlockSize, needed);
+            m_blocks.push_back({ std::make_unique_for_overwrite<char[]>(size), size });
+        }
+        m_blocks.back().serial = m_serial++;
+        m_blocks.back().strings = 0;
+        m_used = 0;
+    }
+    auto& block = m_blocks.back();
+    auto ret = block.data.get() + m_used;
+    ret[length] = '\0';
+    m_used += needed;
+    block.strings += length;
+    m_size += length;
+    return ret;
+}
+
+void StringArena::clear()
+{
+    for (auto& block : m_blocks)
+        m_spare.push_back(std::move(block));
+    m_blocks.clear();
+    m_used = 0;
+    m_size = 0;
+}
+
+size_t StringArena::mark() const
+{
+    return (m_blocks.empty()) ? m_serial : m_blocks.back().serial;
+}
+
+void StringArena::release(size_t mark)
+{
+    while (m_blocks.size() > 1 && m_blocks.front().serial < mark) {
+        m_size -= m_blocks.front().strings;
+        m_spare.push_back(std::move(m_blocks.front()));
+        m_blocks.pop_front();
+    }
+}
+
+size_t StringArena::capacity() const
+{
+    size_t ret = 0;
+    for (auto const& block : m_blocks)
+        ret += block.size;
+    for (auto const& block : m_spare)
+        ret += block.size;
+    return ret;
+}
+
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace Obelix {
+
+/**
+ * Append-only storage for strings that need to outlive the buffer they were
+ * built in. Strings are copied into large blocks and handed out as
+ * string_views, which stay valid until the arena is cleared or destroyed,
+ * or until the block holding them is released. clear() and release() keep
+ * the blocks around, so an arena that is reused doesn't allocate once it
+ * has grown to its working size.
+ */
+class StringArena {
+public:
+    static constexpr size_t BlockSize = 16 * 1024;
+
+    StringArena() = default;
+    StringArena(StringArena const&) = delete;
+    StringArena(StringArena&&) = default;
+    StringArena& operator=(StringArena const&) = delete;
+    StringArena& operator=(StringArena&&) = default;
+
+    /**
+     * Copies str into the arena and returns a view of the copy. The copy is
+     * NUL terminated.
+     */
+    [[nodiscard]] std::string_view add(std::string_view str);
+
+    /**
+     * Returns room for a string of the given length, followed by a NUL,
+     * for the caller to fill in.
+     */
+    [[nodiscard]] char* allocate(size_t length);
+    void clear();
+
+    /**
+     * A mark for the current end of the arena. Strings added after this
+     * call are stored at or after the mark.
+     */
+    [[nodiscard]] size_t mark() const;
+
+    /**
+     * Recycles the blocks that were filled up before the block holding
+     * mark. The strings in them become invalid. This lets the owner of an
+     * arena that only ever needs its most recent strings, like a streaming
+     * Lexer, keep its size bounded.
+     */
+    void release(size_t mark);
+
+    [[nodiscard]] size_t size() const { return m_size; }
+    [[nodiscard]] size_t capacity() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+        size_t serial { 0 };
+        size_t strings { 0 }; // Bytes of string data stored in the block
+    };
+
+    // The blocks holding strings, oldest first. Strings are added to the
+    // last one.
+    std::deque<Block> m_blocks {};
+    std::vector<Block> m_spare {};
+    size_t m_used { 0 };
+    size_t m_size { 0 };
+    size_t m_serial { 0 };
+};
+
+}
@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+
+#include <core/ByteScan.h>
 #include <core/Logging.h>
 #include <core/StringBuffer.h>
 
@@ -11,9 +14,100 @@ namespace Obelix {
 
 logging_category(stringbuffer);
 
+LineIndex::LineIndex(std::string_view text)
+    : m_text(text)
+{
+}
+
+void LineIndex::assign(std::string_view text)
+{
+    std::lock_guard lock(m_mutex);
+    m_text = text;
+    m_appended = 0;
+    m_discarded = 0;
+    m_pending_cr = false;
+    m_line_starts.clear();
+    m_built = false;
+}
+
+void LineIndex::append(std::string_view chunk)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_appended == 0) {
+        m_text = {};
+        m_discarded = 0;
+        m_line_starts.clear();
+        m_line_starts.push_back(0);
+        m_built = true;
+    }
+    size_t pos = 0;
+    if (m_pending_cr && !chunk.empty() && chunk[0] == '\n')
+        m_line_starts.back() = m_appended + ++pos;
+    m_pending_cr = false;
+    while (pos < chunk.length()) {
+        auto eol = find_any_of(chunk.substr(pos), "\r\n");
+        if (eol == std::string_view::npos)
+            break;
+        pos += eol;
+        if (chunk[pos] == '\r' && pos + 1 == chunk.length())
+            m_pending_cr = true;
+        pos += (chunk[pos] == '\r' && pos + 1 < chunk.length() && chunk[pos + 1] == '\n') ? 2 : 1;
+        m_line_starts.push_back(m_appended + pos);
+    }
+    m_appended += chunk.length();
+}
+
+void LineIndex::build() const
+{
+    if (m_built)
+        return;
+    std::lock_guard lock(m_mutex);
+    if (m_built)
+        return;
+    m_line_starts.clear();
+    m_line_starts.push_back(0);
+    for (size_t pos = 0; pos < m_text.length();) {
+        auto eol = find_any_of(m_text.substr(pos), "\r\n");
+        if (eol == std::string_view::npos)
+            break;
+        pos += eol;
+        pos += (m_text[pos] == '\r' && pos + 1 < m_text.length() && m_text[pos + 1] == '\n') ? 2 : 1;
+        m_line_starts.push_back(pos);
+    }
+    m_built = true;
+}
+
+void LineIndex::discard(size_t offset)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_appended == 0)
+        return;
+    auto line = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset) - m_line_starts.begin();
+    if (line <= 1)
+        return;
+    m_line_starts.erase(m_line_starts.begin(), m_line_starts.begin() + (line - 1));
+    m_discarded += static_cast<size_t>(line - 1);
+}
+
+std::pair<size_t, size_t> LineIndex::line_column(size_t offset) const
+{
+    build();
+    auto line = std::upper_bound(m_line_starts.begin(), m_line_starts.end(), offset) - m_line_starts.begin();
+    if (line == 0)
+        return { 0, 0 };
+    return { m_discarded + line, offset - m_line_starts[line - 1] + 1 };
+}
+
+size_t LineIndex::line_count() const
+{
+    build();
+    return m_discarded + m_line_starts.size();
+}
+
 StringBuffer::StringBuffer(StringBuffer& other)
     : m_buffer_string(other.m_buffer_string)
     , m_char_buffer(other.m_char_buffer)
+    , m_storage(std::move(other.m_storage))
 {
     other.m_buffer_string = {};
     other.m_char_buffer = {};
@@ -24,11 +118,15 @@ StringBuffer::StringBuffer(StringBuffer& other)
     } else {
         m_buffer = other.m_buffer;
     }
+    m_lines = other.m_lines;
+    m_lines->assign(m_buffer);
+    other.m_lines = std::make_shared<LineIndex>(other.m_buffer);
 }
 
 StringBuffer::StringBuffer(StringBuffer&& other) noexcept
     : m_buffer_string(std::move(other.m_buffer_string))
     , m_char_buffer(other.m_char_buffer)
+    , m_storage(std::move(other.m_storage))
 {
     if (m_buffer_string.has_value()) {
         m_buffer = m_buffer_string->c_str();
@@ -39,17 +137,22 @@ StringBuffer::StringBuffer(StringBuffer&& other) noexcept
     }
     other.m_char_buffer = {};
     other.m_buffer_string = {};
+    m_lines = std::move(other.m_lines);
+    m_lines->assign(m_buffer);
+    other.m_lines = std::make_shared<LineIndex>();
 }
 
 StringBuffer::StringBuffer(std::string str)
     : m_buffer_string(std::move(str))
     , m_buffer(m_buffer_string.value().c_str())
 {
+    m_lines->assign(m_buffer);
 }
 
 StringBuffer::StringBuffer(std::string_view str)
     : m_buffer(str)
 {
+    m_lines->assign(m_buffer);
 }
 
 StringBuffer::StringBuffer(char const* str, bool take_ownership)
@@ -57,6 +160,14 @@ StringBuffer::StringBuffer(char const* str, bool take_ownership)
     if (take_ownership && str)
         m_char_buffer = str;
     m_buffer = (str) ? str : "";
+    m_lines->assign(m_buffer);
+}
+
+StringBuffer::StringBuffer(std::string_view str, std::shared_ptr<void const> storage)
+    : m_storage(std::move(storage))
+    , m_buffer(str)
+{
+    m_lines->assign(m_buffer);
 }
 
 StringBuffer::~StringBuffer()
@@ -70,9 +181,12 @@ StringBuffer& StringBuffer::assign(std::string buffer)
     if (m_char_buffer.has_value())
         delete[] m_char_buffer.value();
     m_char_buffer = {};
+    m_storage = {};
     m_buffer_string = std::move(buffer);
     m_buffer = m_buffer_string.value().c_str();
-    m_pos = m_mark = 0;
+    m_pos = m_mark = m_base = 0;
+    release();
+    m_lines->assign(m_buffer);
     return *this;
 }
 
@@ -91,8 +205,11 @@ StringBuffer& StringBuffer::assign(const char* buffer, bool take_ownership)
         m_char_buffer = buffer;
     }
     m_buffer_string = {};
+    m_storage = {};
     m_buffer = buffer;
-    m_pos = m_mark = 0;
+    m_pos = m_mark = m_base = 0;
+    release();
+    m_lines->assign(m_buffer);
     return *this;
 }
 
@@ -112,16 +229,24 @@ StringBuffer& StringBuffer::assign(StringBuffer buffer)
     } else {
         m_buffer = buffer.m_buffer;
     }
-    m_pos = m_mark = 0;
+    m_storage = std::move(buffer.m_storage);
+    m_pos = m_mark = m_base = 0;
+    release();
+    m_lines->assign(m_buffer);
     return *this;
 }
 
 StringBuffer& StringBuffer::assign(std::string_view buffer)
 {
+    if (m_char_buffer.has_value())
+        delete[] m_char_buffer.value();
     m_buffer_string = {};
     m_char_buffer = {};
+    m_storage = {};
     m_buffer = buffer;
-    m_pos = m_mark = 0;
+    m_pos = m_mark = m_base = 0;
+    release();
+    m_lines->assign(m_buffer);
     return *this;
 }
 
@@ -135,6 +260,21 @@ void StringBuffer::reset()
     m_mark = m_pos;
 }
 
+void StringBuffer::seek(size_t offset)
+{
+    oassert(offset >= m_base && offset <= m_base + m_buffer.length(), "Cannot seek to offset {}: it is not loaded", offset);
+    m_pos = m_mark = offset - m_base;
+}
+
+void StringBuffer::window(std::string_view text, size_t base)
+{
+    oassert(base <= m_base + m_mark && base + text.length() >= m_base + m_pos, "New window does not hold the mark and the position");
+    m_mark = m_mark + m_base - base;
+    m_pos = m_pos + m_base - base;
+    m_base = base;
+    m_buffer = text;
+}
+
 void StringBuffer::partial_rewind(size_t num)
 {
     if (num > (m_pos - m_mark))
@@ -152,18 +292,80 @@ std::string_view StringBuffer::read(size_t num)
 {
     if (static_cast<int>(num) < 0)
         num = 0;
-    if ((m_pos + num) > m_buffer.length())
+    if ((m_pos + num) > m_buffer.length() && !underflow(num))
         num = m_buffer.length() - m_pos;
     auto ret = m_buffer.substr(m_pos, num);
     m_pos = m_pos + num;
     return ret;
 }
 
+/*
+ * Loads input past the end of the window for a bulk scan that started at
+ * offset start. The request grows with the length of the run so far, so
+ * that a windowed buffer that copies the text it loads doesn't copy a long
+ * run over and over. Returns false if no input was added.
+ */
+bool StringBuffer::extend(size_t start)
+{
+    if (!more())
+        return false;
+    auto end = m_base + m_buffer.length();
+    (void) underflow(m_buffer.length() - m_pos + std::max(offset() - start, size_t { 1 }));
+    return m_base + m_buffer.length() > end;
+}
+
+std::string_view StringBuffer::scan_while(ByteClass const& bytes)
+{
+    auto start = offset();
+    do {
+        m_pos += span_of(m_buffer.substr(m_pos), bytes);
+    } while (m_pos == m_buffer.length() && extend(start));
+    return since(start);
+}
+
+std::string_view StringBuffer::scan_until(std::string_view bytes)
+{
+    auto start = offset();
+    do {
+        if (auto at = find_any_of(m_buffer.substr(m_pos), bytes); at != std::string_view::npos) {
+            m_pos += at;
+            break;
+        }
+        m_pos = m_buffer.length();
+    } while (extend(start));
+    return since(start);
+}
+
+std::string_view StringBuffer::find(std::string_view text)
+{
+    auto start = offset();
+    while (true) {
+        if (auto at = m_buffer.find(text, m_pos); at != std::string_view::npos) {
+            m_pos = at;
+            break;
+        }
+        // The end of the window can hold the start of the text.
+        m_pos = std::max(m_pos, m_buffer.length() - std::min(text.length() - 1, m_buffer.length()));
+        if (!extend(start)) {
+            m_pos = m_buffer.length();
+            break;
+        }
+    }
+    return since(start);
+}
+
 std::string_view StringBuffer::scanned_string() const
 {
     return m_buffer.substr(m_mark, m_pos-m_mark);
 }
 
+int StringBuffer::peek(size_t num)
+{
+    if ((m_pos + num) < m_buffer.length() || underflow(num + 1))
+        return m_buffer[m_pos + num];
+    return 0;
+}
+
 int StringBuffer::peek(size_t num) const
 {
     return ((m_pos + num) < m_buffer.length()) ? m_buffer[m_pos + num] : 0;
@@ -171,22 +373,27 @@ int StringBuffer::peek(size_t num) const
 
 int StringBuffer::readchar()
 {
-    return (m_pos < m_buffer.length() - 1) ? m_buffer[++m_pos] : 0;
+    return (m_pos + 1 < m_buffer.length() || underflow(2)) ? m_buffer[++m_pos] : 0;
 }
 
 bool StringBuffer::top() const
 {
-    return m_pos == 0;
+    return m_base + m_pos == 0;
+}
+
+bool StringBuffer::eof()
+{
+    return m_pos >= m_buffer.length() && !underflow(1);
 }
 
 bool StringBuffer::eof() const
 {
-    return m_pos >= m_buffer.length();
+    return m_pos >= m_buffer.length() && !more();
 }
 
 void StringBuffer::skip(size_t num)
 {
-    if (m_pos + num > m_buffer.length()) {
+    if (m_pos + num > m_buffer.length() && !underflow(num)) {
         num = m_buffer.length() - m_pos;
     }
     m_pos += num;
@@ -202,9 +409,7 @@ bool StringBuffer::expect(char ch, size_t offset)
 
 bool StringBuffer::expect(std::string const& str, size_t offset)
 {
-    if (m_buffer.length() < m_pos + offset)
-        return false;
-    if (m_buffer.length() < m_pos + offset + str.length())
+    if (m_buffer.length() < m_pos + offset + str.length() && !underflow(offset + str.length()))
         return false;
     if (m_buffer.substr(m_pos + offset, str.length()) != str)
         return false;
@@ -212,6 +417,11 @@ bool StringBuffer::expect(std::string const& str, size_t offset)
     return true;
 }
 
+bool StringBuffer::is_one_of(std::string const& str, size_t offset)
+{
+    return str.find_first_of(static_cast<char>(peek(offset))) != std::string::npos;
+}
+
 bool StringBuffer::is_one_of(std::string const& str, size_t offset) const
 {
     return str.find_first_of(static_cast<char>(peek(offset))) != std::string::npos;
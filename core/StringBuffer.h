@@ -6,16 +6,70 @@
 
 #pragma once
 
+#include <atomic>
 #include <cerrno>
 #include <fcntl.h>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <vector>
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <core/ByteScan.h>
+
 namespace Obelix {
 
+/**
+ * The offsets at which the lines of a text start, used to turn byte offsets
+ * into line and column numbers. '\n', '\r\n' and a lone '\r' all end a
+ * line. The index is built the first time it is needed, which is usually
+ * when a diagnostic is reported, so lexing a text that never needs one
+ * doesn't pay for it.
+ */
+class LineIndex {
+public:
+    explicit LineIndex(std::string_view text = {});
+
+    void assign(std::string_view text);
+
+    /**
+     * Adds the line starts in the next chunk of a text that is read in
+     * pieces, like the input of a StreamingBuffer. The text itself isn't
+     * kept.
+     */
+    void append(std::string_view chunk);
+
+    /**
+     * Forgets the starts of the lines before the one holding offset, so
+     * that the index of an appended text doesn't grow with the input. Line
+     * numbers stay the same. The line and column of an offset in a
+     * forgotten line are reported as 0, 0. Does nothing if the index is
+     * built from a text that is kept anyway.
+     */
+    void discard(size_t offset);
+
+    /**
+     * The 1-based line and column of the byte at offset.
+     */
+    [[nodiscard]] std::pair<size_t, size_t> line_column(size_t offset) const;
+    [[nodiscard]] size_t line_count() const;
+
+private:
+    void build() const;
+
+    std::string_view m_text;
+    size_t m_appended { 0 };
+    size_t m_discarded { 0 };
+    bool m_pending_cr { false };
+    mutable std::mutex m_mutex;
+    mutable std::atomic<bool> m_built { false };
+    mutable std::vector<size_t> m_line_starts {};
+};
+
 class StringBuffer {
 public:
     StringBuffer() = default;
@@ -24,38 +78,148 @@ public:
     explicit StringBuffer(std::string);
     explicit StringBuffer(std::string_view);
     explicit StringBuffer(char const*, bool=false);
+
+    /**
+     * A buffer over text that is kept alive by storage, for example a
+     * memory mapping. The storage is handed on like owned text is when the
+     * buffer is moved or assigned.
+     */
+    StringBuffer(std::string_view, std::shared_ptr<void const>);
     virtual ~StringBuffer();
-    [[nodiscard]] std::string str() const { return std::string(m_buffer); }
+    [[nodiscard]] virtual std::string str() const { return std::string(m_buffer); }
     [[nodiscard]] operator const std::string_view() const { return m_buffer; }
     [[nodiscard]] std::string_view const& buffer() const { return m_buffer; }
+    [[nodiscard]] std::shared_ptr<void const> const& storage() const { return m_storage; }
     void rewind();
     void reset();
     void partial_rewind(size_t);
     [[maybe_unused]] void pushback();
+    [[nodiscard]] size_t position() const { return m_pos; }
+
+    /**
+     * For a windowed buffer, buffer() only holds part of the input, and
+     * position() is relative to its start. base() is the offset of that
+     * start in the whole input, and offset() the offset of the position.
+     */
+    [[nodiscard]] size_t base() const { return m_base; }
+    [[nodiscard]] size_t offset() const { return m_base + m_pos; }
+
+    /**
+     * Whether there is input after the end of buffer() that hasn't been
+     * loaded yet. Loading it may move the text buffer() refers to.
+     */
+    [[nodiscard]] virtual bool more() const { return false; }
+
+    /**
+     * Whether the text buffer() refers to can be overwritten or released
+     * when more input is loaded. Slices of it then have to be copied to be
+     * kept.
+     */
+    [[nodiscard]] virtual bool transient() const { return false; }
+
+    /**
+     * Loads input until there are at least num bytes after the position,
+     * or until the end of the input. Returns false in the latter case.
+     */
+    bool fill(size_t num) { return m_pos + num <= m_buffer.length() || underflow(num); }
+
+    /**
+     * Keeps the input from offset on loaded, also after the mark moves
+     * past it, until release() is called.
+     */
+    void hold(size_t offset) { m_hold = offset; }
+    void release() { m_hold = std::numeric_limits<size_t>::max(); }
+
+    /**
+     * Moves the mark and the position back to offset, which must be at or
+     * after the mark or the held offset.
+     */
+    void seek(size_t offset);
     [[nodiscard]] size_t scanned() const { return m_pos - m_mark; }
     [[nodiscard]] std::string_view scanned_string() const;
     std::string_view read(size_t);
+
+    /**
+     * Bulk versions of skip(). They move the position past a run of bytes
+     * in one step, loading more input as needed, and return the bytes they
+     * moved past, like read() does. scan_while() skips bytes in the class,
+     * scan_until() skips up to the first of the given bytes, and find()
+     * skips up to the first occurrence of the given text. The last two
+     * skip to the end of the input if there is no such byte or text.
+     */
+    std::string_view scan_while(ByteClass const&);
+    std::string_view scan_until(std::string_view);
+    std::string_view find(std::string_view);
+
+    /**
+     * peek(), is_one_of() and eof() load more input of a windowed buffer
+     * when they need it. Their const versions only look at the input that
+     * is loaded; peek() returns 0 past its end, and eof() is only true when
+     * there is no more input.
+     */
+    [[nodiscard]] int peek(size_t = 0);
     [[nodiscard]] int peek(size_t = 0) const;
     int one_of(std::string const&);
     bool expect(char, size_t = 0);
     bool expect(std::string const&, size_t = 0);
+    [[nodiscard]] bool is_one_of(std::string const&, size_t = 0);
     [[nodiscard]] bool is_one_of(std::string const&, size_t = 0) const;
     [[maybe_unused]] bool expect_one_of(std::string const&, size_t = 0);
     int readchar();
     void skip(size_t = 1);
     [[nodiscard]] bool top() const;
+    [[nodiscard]] bool eof();
     [[nodiscard]] bool eof() const;
     StringBuffer& assign(char const* buffer, bool take_ownership=false);
     StringBuffer& assign(std::string);
     StringBuffer& assign(StringBuffer);
     StringBuffer& assign(std::string_view);
 
+    /**
+     * The line index of the text. It stays at the same address for the
+     * lifetime of the buffer, also when new text is assigned, so it can be
+     * referenced from tokens.
+     */
+    [[nodiscard]] LineIndex const& lines() const { return *m_lines; }
+
+    /**
+     * Lets the line index of a windowed buffer forget the lines before
+     * offset. See LineIndex::discard().
+     */
+    void discard_lines(size_t offset) { m_lines->discard(offset); }
+
+protected:
+    /**
+     * Called when a read goes past the end of buffer(). A windowed buffer
+     * loads more input, so that there are at least the given number of
+     * bytes after the position, and installs it with window(). Returns
+     * false if there isn't enough input left.
+     */
+    virtual bool underflow(size_t) { return false; }
+
+    /**
+     * Makes text, starting at offset base of the input, the new contents
+     * of buffer(). It must hold the input from the mark on.
+     */
+    void window(std::string_view text, size_t base);
+
+    [[nodiscard]] size_t mark() const { return m_mark; }
+    [[nodiscard]] size_t held() const { return m_hold; }
+    [[nodiscard]] LineIndex& line_index() { return *m_lines; }
+
 private:
+    bool extend(size_t);
+    [[nodiscard]] std::string_view since(size_t start) const { return m_buffer.substr(start - m_base, offset() - start); }
+
     std::optional<std::string> m_buffer_string {};
     std::optional<char const*> m_char_buffer {};
+    std::shared_ptr<void const> m_storage {};
     std::string_view m_buffer;
     size_t m_pos { 0 };
     size_t m_mark { 0 };
+    size_t m_base { 0 };
+    size_t m_hold { std::numeric_limits<size_t>::max() };
+    std::shared_ptr<LineIndex> m_lines { std::make_shared<LineIndex>() };
 };
 
 }
@@ -6,8 +6,10 @@
 
 #pragma once
 
+#include <cassert>
 #include <cxxabi.h>
 #include <map>
+#include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
@@ -196,6 +198,14 @@ struct to_string<char*> {
     }
 };
 
+template<>
+struct to_string<char const*> {
+    std::string operator()(char const* value)
+    {
+        return { value };
+    }
+};
+
 template<>
 struct to_string<void*> {
     std::string operator()(void const* value)
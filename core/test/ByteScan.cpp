@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cctype>
+#include <random>
+
+#include <core/ByteScan.h>
+#include <gtest/gtest.h>
+
+static size_t reference_whitespace_span(std::string_view text, bool include_newlines)
+{
+    size_t ret = 0;
+    for (; ret < text.length() && isspace(text[ret]); ++ret) {
+        if (!include_newlines && (text[ret] == '\n' || text[ret] == '\r'))
+            break;
+    }
+    return ret;
+}
+
+TEST(ByteScan, WhitespaceSpan)
+{
+    EXPECT_EQ(Obelix::whitespace_span(""), 0);
+    EXPECT_EQ(Obelix::whitespace_span("x  "), 0);
+    EXPECT_EQ(Obelix::whitespace_span(" x"), 1);
+    EXPECT_EQ(Obelix::whitespace_span(" \t\v\f\r\nx"), 6);
+    EXPECT_EQ(Obelix::whitespace_span(" \t\v\f\r\nx", false), 4);
+    EXPECT_EQ(Obelix::whitespace_span(std::string(100, ' ')), 100);
+    EXPECT_EQ(Obelix::whitespace_span(std::string(40, ' ') + std::string(1, '\0') + "   "), 40);
+}
+
+TEST(ByteScan, WhitespaceSpanBlockBoundaries)
+{
+    for (auto len = 0u; len < 80; ++len) {
+        auto text = std::string(len, ' ') + "x" + std::string(40, ' ');
+        EXPECT_EQ(Obelix::whitespace_span(text), len);
+        EXPECT_EQ(Obelix::whitespace_span(std::string_view(text).substr(0, len)), len);
+        text[len] = '\n';
+        EXPECT_EQ(Obelix::whitespace_span(text, false), len);
+    }
+}
+
+TEST(ByteScan, WhitespaceSpanRandom)
+{
+    std::mt19937 rng(42);
+    std::string alphabet(" \t\v\f\r\n a\x80\xa0\x09");
+    std::uniform_int_distribution<size_t> pick(0, alphabet.length() - 1);
+    std::uniform_int_distribution<size_t> length(0, 100);
+    for (auto ix = 0; ix < 2000; ++ix) {
+        std::string text(length(rng), ' ');
+        for (auto& ch : text) {
+            if (pick(rng) < 2)
+                ch = alphabet[pick(rng)];
+        }
+        EXPECT_EQ(Obelix::whitespace_span(text), reference_whitespace_span(text, true)) << ix;
+        EXPECT_EQ(Obelix::whitespace_span(text, false), reference_whitespace_span(text, false)) << ix;
+    }
+}
+
+TEST(ByteScan, FindAnyOf)
+{
+    using namespace std::literals;
+    EXPECT_EQ(Obelix::find_any_of("", "'\\"), std::string_view::npos);
+    EXPECT_EQ(Obelix::find_any_of("abc", "'\\"), std::string_view::npos);
+    EXPECT_EQ(Obelix::find_any_of("ab'c", "'"), 2);
+    EXPECT_EQ(Obelix::find_any_of("ab\0'c"sv, "'\0"sv), 2);
+    EXPECT_EQ(Obelix::find_any_of("abcdef", "fedcb"), 1);
+    for (auto len = 0u; len < 80; ++len) {
+        auto text = std::string(len, 'x') + "\\" + std::string(40, '\'');
+        EXPECT_EQ(Obelix::find_any_of(text, "'\\\"`"), len);
+        EXPECT_EQ(Obelix::find_any_of(std::string_view(text).substr(0, len), "'\\"), std::string_view::npos);
+    }
+}
+
+static size_t reference_span_of(std::string_view text, std::bitset<256> const& bytes)
+{
+    size_t ret = 0;
+    while (ret < text.length() && bytes[static_cast<unsigned char>(text[ret])])
+        ++ret;
+    return ret;
+}
+
+TEST(ByteScan, SpanOf)
+{
+    auto identifier = Obelix::ByteClass::matching([](int ch) { return isalnum(ch) || ch == '_'; });
+    EXPECT_EQ(Obelix::span_of("", identifier), 0);
+    EXPECT_EQ(Obelix::span_of("foo_bar1 = 2", identifier), 8);
+    EXPECT_EQ(Obelix::span_of("foo_bar1 = 2", identifier.complement()), 0);
+    EXPECT_EQ(Obelix::span_of(" = 2", identifier.complement()), 3);
+    EXPECT_TRUE(Obelix::ByteClass("\xff").contains(0xff));
+    EXPECT_FALSE(Obelix::ByteClass("\xff").contains(0x7f));
+    for (auto len = 0u; len < 80; ++len) {
+        auto text = std::string(len, 'a') + "-" + std::string(40, 'a');
+        EXPECT_EQ(Obelix::span_of(text, identifier), len);
+        EXPECT_EQ(Obelix::span_of(std::string_view(text).substr(0, len), identifier), len);
+    }
+}
+
+TEST(ByteScan, SpanOfRandom)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+    std::uniform_int_distribution<size_t> length(0, 100);
+    for (auto ix = 0; ix < 200; ++ix) {
+        /*
+         * Classes of a few bytes can be scanned with nibble tables, random
+         * classes of many bytes usually can't.
+         */
+        std::bitset<256> bytes;
+        auto count = (ix % 2) ? 128 : 4;
+        for (auto n = 0; n < count; ++n)
+            bytes.set(byte(rng));
+        Obelix::ByteClass byte_class(bytes);
+        EXPECT_EQ(byte_class.bytes(), bytes);
+        std::string members;
+        for (auto b = 0u; b < 256; ++b) {
+            if (bytes[b])
+                members += static_cast<char>(b);
+        }
+        std::uniform_int_distribution<size_t> pick(0, members.length() - 1);
+        for (auto n = 0; n < 10; ++n) {
+            std::string text(length(rng), ' ');
+            for (auto& ch : text)
+                ch = (byte(rng) < 250) ? members[pick(rng)] : static_cast<char>(byte(rng));
+            EXPECT_EQ(Obelix::span_of(text, byte_class), reference_span_of(text, bytes)) << ix;
+            EXPECT_EQ(Obelix::span_of(text, byte_class.complement()), reference_span_of(text, ~bytes)) << ix;
+        }
+    }
+}
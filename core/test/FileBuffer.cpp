@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fstream>
+#include <string>
+#include <unistd.h>
+
+#include <core/FileBuffer.h>
+#include <core/test/TempFiles.h>
+#include <gtest/gtest.h>
+
+class FileBufferTest : public TempFiles {
+};
+
+TEST_F(FileBufferTest, ReadsSmallFiles)
+{
+    auto file_name = write("filebuffer", "Hello, World!\n");
+    auto buffer_or_error = Obelix::FileBuffer::from_file(file_name);
+    ASSERT_FALSE(buffer_or_error.is_error());
+    auto buffer = buffer_or_error.value();
+    EXPECT_FALSE(buffer->mapped());
+    EXPECT_EQ(buffer->buffer(), "Hello, World!\n");
+}
+
+TEST_F(FileBufferTest, MapsLargeFiles)
+{
+    auto contents = std::string(10000, 'x');
+    auto file_name = write("filebuffer", contents);
+    auto buffer_or_error = Obelix::FileBuffer::from_file(file_name, nullptr, { .map_threshold = 4096, .populate = true });
+    ASSERT_FALSE(buffer_or_error.is_error());
+    auto buffer = buffer_or_error.value();
+    EXPECT_TRUE(buffer->mapped());
+    EXPECT_EQ(buffer->buffer(), contents);
+    EXPECT_EQ(buffer->buffer().data()[contents.length()], '\0');
+}
+
+TEST_F(FileBufferTest, MappedFilesEndInNul)
+{
+    // A file that exactly fills its pages:
+    auto contents = std::string(static_cast<size_t>(sysconf(_SC_PAGESIZE)) * 2, 'y');
+    auto file_name = write("filebuffer", contents);
+    auto buffer_or_error = Obelix::FileBuffer::from_file(file_name, nullptr, { .map_threshold = 0 });
+    ASSERT_FALSE(buffer_or_error.is_error());
+    auto buffer = buffer_or_error.value();
+    EXPECT_TRUE(buffer->mapped());
+    EXPECT_EQ(buffer->buffer().data()[contents.length()], '\0');
+
+    // The mapping moves along with the text, like owned text does:
+    Obelix::StringBuffer moved(std::move(*buffer));
+    buffer.reset();
+    EXPECT_EQ(moved.buffer(), contents);
+    moved.skip(contents.length() - 1);
+    EXPECT_EQ(moved.peek(), 'y');
+    EXPECT_EQ(moved.peek(1), 0);
+}
+
+class SearchPathTest : public TempFiles {
+protected:
+    void SetUp() override
+    {
+        m_root = temp_path("searchpath");
+        Obelix::fs::create_directories(m_root / "first");
+        Obelix::fs::create_directories(m_root / "second" / "std");
+    }
+
+    Obelix::fs::path add(Obelix::fs::path const& name)
+    {
+        auto path = m_root / name;
+        std::ofstream out(path);
+        out << name.string();
+        return path;
+    }
+
+    Obelix::fs::path m_root;
+};
+
+TEST_F(SearchPathTest, FirstDirectoryWins)
+{
+    add("first/a.obl");
+    auto second_a = add("second/a.obl");
+    auto second_b = add("second/std/b.obl");
+    Obelix::SearchPathBufferLocator locator({ m_root / "first", m_root / "second" }, false);
+    auto a = locator.locate("a.obl");
+    ASSERT_FALSE(a.is_error());
+    EXPECT_EQ(a.value(), m_root / "first" / "a.obl");
+    auto b = locator.locate("./std/b.obl");
+    ASSERT_FALSE(b.is_error());
+    EXPECT_EQ(b.value(), second_b);
+    auto absolute = locator.locate(second_a.string());
+    ASSERT_FALSE(absolute.is_error());
+    EXPECT_EQ(absolute.value(), second_a);
+    auto missing = locator.locate("c.obl");
+    ASSERT_TRUE(missing.is_error());
+    EXPECT_EQ(missing.error().code(), Obelix::ErrorCode::NoSuchFile);
+    EXPECT_TRUE(locator.locate("std").is_error());
+}
+
+TEST_F(SearchPathTest, Invalidate)
+{
+    Obelix::SearchPathBufferLocator locator({ m_root / "first", m_root / "second" }, false, false);
+    EXPECT_TRUE(locator.locate("a.obl").is_error());
+    add("second/a.obl");
+    EXPECT_TRUE(locator.locate("a.obl").is_error());
+    locator.invalidate();
+    auto a = locator.locate("a.obl");
+    ASSERT_FALSE(a.is_error());
+    EXPECT_EQ(a.value(), m_root / "second" / "a.obl");
+}
+
+TEST_F(SearchPathTest, Watch)
+{
+    Obelix::SearchPathBufferLocator locator({ m_root / "first", m_root / "second" }, false);
+    EXPECT_TRUE(locator.locate("std/a.obl").is_error());
+    add("second/std/a.obl");
+    auto a = locator.locate("std/a.obl");
+    ASSERT_FALSE(a.is_error());
+    EXPECT_EQ(a.value(), m_root / "second" / "std" / "a.obl");
+    Obelix::fs::remove(m_root / "second" / "std" / "a.obl");
+    EXPECT_TRUE(locator.locate("std/a.obl").is_error());
+}
+
+TEST_F(SearchPathTest, ObelixDirectory)
+{
+    add("second/std/b.obl");
+    setenv("OBL_DIR", (m_root / "second").c_str(), 1);
+    Obelix::SearchPathBufferLocator locator({ m_root / "first" });
+    unsetenv("OBL_DIR");
+    EXPECT_EQ(locator.directories().back(), m_root / "second");
+    auto b = locator.locate("std/b.obl");
+    ASSERT_FALSE(b.is_error());
+    EXPECT_EQ(b.value(), m_root / "second" / "std" / "b.obl");
+}
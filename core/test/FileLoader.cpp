@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <set>
+#include <string>
+
+#include <core/FileLoader.h>
+#include <core/test/TempFiles.h>
+#include <gtest/gtest.h>
+
+class FileLoaderTest : public TempFiles {
+protected:
+    void SetUp() override
+    {
+        for (auto ix = 0; ix < 20; ++ix)
+            m_paths.push_back(write("fileloader_" + std::to_string(ix), "File " + std::to_string(ix) + "\n"));
+    }
+
+    std::vector<std::string> m_paths;
+};
+
+TEST_F(FileLoaderTest, LoadsAll)
+{
+    auto file_names = m_paths;
+    file_names.emplace_back("/this/file/does/not/exist");
+    Obelix::FileLoader loader(file_names, nullptr, {}, 4);
+    std::set<size_t> seen;
+    for (auto loaded = loader.next(); loaded.has_value(); loaded = loader.next()) {
+        EXPECT_TRUE(seen.insert(loaded->index).second);
+        EXPECT_EQ(loaded->file_name, file_names[loaded->index]);
+        if (loaded->index == m_paths.size()) {
+            ASSERT_TRUE(loaded->buffer.is_error());
+            EXPECT_EQ(loaded->buffer.error().code(), Obelix::ErrorCode::NoSuchFile);
+        } else {
+            ASSERT_FALSE(loaded->buffer.is_error());
+            EXPECT_EQ(loaded->buffer.value()->buffer(), "File " + std::to_string(loaded->index) + "\n");
+        }
+    }
+    EXPECT_EQ(seen.size(), file_names.size());
+}
+
+TEST_F(FileLoaderTest, WaitReturnsFilesInOrder)
+{
+    Obelix::FileLoader loader(m_paths);
+    auto first = loader.next();
+    ASSERT_TRUE(first.has_value());
+    auto rest = loader.wait();
+    ASSERT_EQ(rest.size(), m_paths.size() - 1);
+    for (auto ix = 1u; ix < rest.size(); ++ix)
+        EXPECT_LT(rest[ix - 1].index, rest[ix].index);
+    EXPECT_FALSE(loader.next().has_value());
+}
+
+TEST_F(FileLoaderTest, AbandonedLoader)
+{
+    Obelix::FileLoader loader(m_paths, nullptr, {}, 2);
+    EXPECT_TRUE(loader.next().has_value());
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <core/StringBuffer.h>
+#include <gtest/gtest.h>
+
+TEST(LineIndex, LineColumn)
+{
+    Obelix::LineIndex lines("ab\ncd\r\nef\rgh\n\nij");
+    EXPECT_EQ(lines.line_count(), 6);
+    EXPECT_EQ(lines.line_column(0), std::make_pair(1ul, 1ul));
+    EXPECT_EQ(lines.line_column(2), std::make_pair(1ul, 3ul));
+    EXPECT_EQ(lines.line_column(3), std::make_pair(2ul, 1ul));
+    EXPECT_EQ(lines.line_column(6), std::make_pair(2ul, 4ul));
+    EXPECT_EQ(lines.line_column(7), std::make_pair(3ul, 1ul));
+    EXPECT_EQ(lines.line_column(10), std::make_pair(4ul, 1ul));
+    EXPECT_EQ(lines.line_column(13), std::make_pair(5ul, 1ul));
+    EXPECT_EQ(lines.line_column(15), std::make_pair(6ul, 2ul));
+    EXPECT_EQ(lines.line_column(16), std::make_pair(6ul, 3ul));
+}
+
+TEST(LineIndex, LongLines)
+{
+    std::string text;
+    for (auto ix = 0; ix < 100; ++ix)
+        text += std::string(ix, 'x') + ((ix % 2) ? "\r\n" : "\n");
+    Obelix::LineIndex lines(text);
+    EXPECT_EQ(lines.line_count(), 101);
+    size_t offset = 0;
+    for (auto ix = 0ul; ix < 100; ++ix) {
+        EXPECT_EQ(lines.line_column(offset + ix), std::make_pair(ix + 1, ix + 1));
+        offset += ix + ((ix % 2) ? 2 : 1);
+    }
+}
+
+TEST(LineIndex, FollowsBuffer)
+{
+    Obelix::StringBuffer buffer(std::string("a\nb"));
+    auto const& lines = buffer.lines();
+    EXPECT_EQ(lines.line_column(2), std::make_pair(2ul, 1ul));
+    buffer.assign(std::string("abc"));
+    EXPECT_EQ(&buffer.lines(), &lines);
+    EXPECT_EQ(lines.line_column(2), std::make_pair(1ul, 3ul));
+}
+
+TEST(LineIndex, DiscardKeepsLineNumbers)
+{
+    Obelix::LineIndex lines;
+    lines.append("ab\ncd\r");
+    lines.append("\nef\ngh");
+    lines.discard(7);
+    EXPECT_EQ(lines.line_count(), 4);
+    EXPECT_EQ(lines.line_column(7), std::make_pair(3ul, 1ul));
+    EXPECT_EQ(lines.line_column(10), std::make_pair(4ul, 1ul));
+    EXPECT_EQ(lines.line_column(1), std::make_pair(0ul, 0ul));
+    lines.append("\nij");
+    EXPECT_EQ(lines.line_column(13), std::make_pair(5ul, 1ul));
+
+    Obelix::LineIndex text("ab\ncd");
+    text.discard(4);
+    EXPECT_EQ(text.line_column(1), std::make_pair(1ul, 2ul));
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <core/SegmentedBuffer.h>
+#include <gtest/gtest.h>
+
+TEST(SegmentedBuffer, ReadsAcrossSegments)
+{
+    std::vector<std::string> lines { "first", "", "third line", "fourth" };
+    Obelix::SegmentedBuffer buffer(lines, "\n");
+    EXPECT_EQ(buffer.str(), "first\n\nthird line\nfourth");
+    EXPECT_EQ(buffer.length(), 24u);
+    std::string read;
+    for (auto ch = buffer.peek(); ch; ch = buffer.peek()) {
+        read += static_cast<char>(ch);
+        buffer.skip();
+    }
+    EXPECT_EQ(read, buffer.str());
+    EXPECT_TRUE(buffer.eof());
+    EXPECT_EQ(buffer.scanned_string(), buffer.str());
+}
+
+TEST(SegmentedBuffer, CopiesOnlyAcrossBoundaries)
+{
+    std::vector<std::string> lines { "abc def", "ghi" };
+    Obelix::SegmentedBuffer buffer(lines, "\n");
+
+    // Within a segment, the window is the segment:
+    buffer.skip(4);
+    buffer.reset();
+    EXPECT_EQ(buffer.read(3), "def");
+    EXPECT_EQ(buffer.scanned_string().data(), lines[0].data() + 4);
+    EXPECT_FALSE(buffer.transient());
+
+    // Reading on crosses into the next segments:
+    EXPECT_EQ(buffer.read(3), "\ngh");
+    EXPECT_EQ(buffer.scanned_string(), "def\ngh");
+    EXPECT_TRUE(buffer.transient());
+    buffer.partial_rewind(2);
+    EXPECT_EQ(buffer.scanned_string(), "def\n");
+    buffer.rewind();
+    EXPECT_EQ(buffer.offset(), 4u);
+
+    // Once the mark is in the last segment, the window is that segment again:
+    buffer.skip(4);
+    buffer.reset();
+    EXPECT_EQ(buffer.read(10), "ghi");
+    EXPECT_EQ(buffer.scanned_string().data(), lines[1].data());
+    EXPECT_FALSE(buffer.transient());
+}
+
+TEST(SegmentedBuffer, IndexesLines)
+{
+    Obelix::SegmentedBuffer buffer(std::vector<std::string> { "ab", "cd\r", "", "ef" }, "\n");
+    Obelix::LineIndex expected("ab\ncd\r\n\nef");
+    EXPECT_EQ(buffer.lines().line_count(), expected.line_count());
+    for (auto offset = 0u; offset < buffer.length(); ++offset)
+        EXPECT_EQ(buffer.lines().line_column(offset), expected.line_column(offset));
+}
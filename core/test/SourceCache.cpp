@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string>
+
+#include <core/SourceCache.h>
+#include <core/test/TempFiles.h>
+#include <gtest/gtest.h>
+
+class SourceCacheTest : public TempFiles {
+};
+
+TEST_F(SourceCacheTest, SharesText)
+{
+    Obelix::SourceCache cache;
+    auto file_name = write("a", "Hello, World!\n");
+    auto first = cache.get(file_name);
+    ASSERT_FALSE(first.is_error());
+    auto second = cache.get(file_name);
+    ASSERT_FALSE(second.is_error());
+    EXPECT_NE(first.value(), second.value());
+    EXPECT_EQ(second.value()->buffer(), "Hello, World!\n");
+    EXPECT_EQ(first.value()->buffer().data(), second.value()->buffer().data());
+    auto stats = cache.statistics();
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_EQ(stats.hits, 1u);
+    EXPECT_EQ(stats.entries, 1u);
+    EXPECT_EQ(stats.bytes, 14u);
+}
+
+TEST_F(SourceCacheTest, ReloadsChangedFiles)
+{
+    Obelix::SourceCache cache;
+    auto file_name = write("a", "Hello, World!\n");
+    auto first = cache.get(file_name);
+    ASSERT_FALSE(first.is_error());
+    write("a", "Goodbye, World!\n");
+    auto second = cache.get(file_name);
+    ASSERT_FALSE(second.is_error());
+    EXPECT_EQ(second.value()->buffer(), "Goodbye, World!\n");
+    EXPECT_EQ(first.value()->buffer(), "Hello, World!\n");
+    EXPECT_EQ(cache.statistics().misses, 2u);
+    EXPECT_EQ(cache.statistics().bytes, 16u);
+}
+
+TEST_F(SourceCacheTest, EvictsLeastRecentlyUsed)
+{
+    Obelix::SourceCache cache(25);
+    auto a = write("a", "0123456789");
+    auto b = write("b", "abcdefghij");
+    auto c = write("c", "ABCDEFGHIJ");
+    ASSERT_FALSE(cache.get(a).is_error());
+    ASSERT_FALSE(cache.get(b).is_error());
+    ASSERT_FALSE(cache.get(a).is_error());
+    ASSERT_FALSE(cache.get(c).is_error());
+    auto stats = cache.statistics();
+    EXPECT_EQ(stats.evictions, 1u);
+    EXPECT_EQ(stats.entries, 2u);
+    ASSERT_FALSE(cache.get(a).is_error());
+    EXPECT_EQ(cache.statistics().hits, 2u);
+    ASSERT_FALSE(cache.get(b).is_error());
+    EXPECT_EQ(cache.statistics().misses, 4u);
+}
+
+TEST_F(SourceCacheTest, NoSuchFile)
+{
+    Obelix::SourceCache cache;
+    auto buffer = cache.get("/this/file/does/not/exist");
+    ASSERT_TRUE(buffer.is_error());
+    EXPECT_EQ(buffer.error().code(), Obelix::ErrorCode::NoSuchFile);
+}
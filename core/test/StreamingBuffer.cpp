@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string>
+#include <unistd.h>
+
+#include <core/StreamingBuffer.h>
+#include <gtest/gtest.h>
+
+static int pipe_with(std::string const& contents)
+{
+    int fds[2];
+    EXPECT_EQ(pipe(fds), 0);
+    EXPECT_EQ(write(fds[1], contents.data(), contents.length()), static_cast<ssize_t>(contents.length()));
+    close(fds[1]);
+    return fds[0];
+}
+
+static std::string numbered(size_t size)
+{
+    std::string ret;
+    for (auto ix = 0u; ret.length() < size; ++ix)
+        ret += std::to_string(ix) + ((ix % 7) ? " " : "\r\n");
+    return ret;
+}
+
+TEST(StreamingBuffer, ReadsInWindows)
+{
+    auto text = numbered(3000);
+    Obelix::StreamingBuffer buffer(pipe_with(text), 16);
+    EXPECT_TRUE(buffer.more());
+    std::string read;
+    for (auto ch = buffer.peek(); ch; ch = buffer.peek()) {
+        read += static_cast<char>(ch);
+        buffer.skip();
+        buffer.reset();
+        EXPECT_LE(buffer.buffer().length(), 32u);
+    }
+    EXPECT_EQ(read, text);
+    EXPECT_TRUE(buffer.eof());
+    EXPECT_FALSE(buffer.more());
+    EXPECT_EQ(buffer.offset(), text.length());
+}
+
+TEST(StreamingBuffer, KeepsTheMarkLoaded)
+{
+    auto text = numbered(3000);
+    Obelix::StreamingBuffer buffer(pipe_with(text), 16);
+    buffer.skip(100);
+    buffer.reset();
+    EXPECT_EQ(buffer.read(200), text.substr(100, 200));
+    EXPECT_EQ(buffer.scanned(), 200u);
+    buffer.partial_rewind(50);
+    EXPECT_EQ(buffer.offset(), 250u);
+    EXPECT_EQ(buffer.peek(), text[250]);
+    buffer.rewind();
+    EXPECT_EQ(buffer.offset(), 100u);
+    EXPECT_EQ(buffer.peek(), text[100]);
+    EXPECT_EQ(buffer.scanned_string(), "");
+}
+
+TEST(StreamingBuffer, HoldAndSeek)
+{
+    auto text = numbered(3000);
+    Obelix::StreamingBuffer buffer(pipe_with(text), 16);
+    buffer.skip(10);
+    buffer.reset();
+    buffer.hold(10);
+    buffer.skip(500);
+    buffer.reset();
+    EXPECT_EQ(buffer.peek(1000), text[1510]);
+    buffer.seek(10);
+    EXPECT_EQ(buffer.offset(), 10u);
+    EXPECT_EQ(buffer.read(20), text.substr(10, 20));
+    buffer.release();
+}
+
+TEST(StreamingBuffer, IndexesLines)
+{
+    auto text = numbered(3000);
+    Obelix::StreamingBuffer buffer(pipe_with(text), 15);
+    while (!buffer.eof()) {
+        buffer.skip(7);
+        buffer.reset();
+    }
+    Obelix::LineIndex expected(text);
+    EXPECT_EQ(buffer.lines().line_count(), expected.line_count());
+    for (auto offset = 0u; offset < text.length(); offset += 13)
+        EXPECT_EQ(buffer.lines().line_column(offset), expected.line_column(offset));
+}
+
+TEST(StreamingBuffer, ConstAccessDoesNotLoad)
+{
+    auto text = numbered(3000);
+    Obelix::StreamingBuffer buffer(pipe_with(text), 16);
+    Obelix::StringBuffer const& view = buffer;
+    EXPECT_EQ(view.peek(), 0);
+    EXPECT_FALSE(view.eof());
+    EXPECT_EQ(buffer.peek(), '0');
+    EXPECT_EQ(view.peek(), '0');
+    EXPECT_TRUE(view.is_one_of("0"));
+    EXPECT_EQ(view.peek(buffer.buffer().length()), 0);
+    while (!buffer.eof()) {
+        buffer.skip();
+        buffer.reset();
+    }
+    EXPECT_TRUE(view.eof());
+}
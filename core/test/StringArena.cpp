@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <string>
+
+#include <core/StringArena.h>
+#include <gtest/gtest.h>
+
+TEST(StringArena, Add)
+{
+    Obelix::StringArena arena;
+    auto hello = arena.add("Hello");
+    auto empty = arena.add("");
+    auto world = arena.add("World");
+    EXPECT_EQ(hello, "Hello");
+    EXPECT_EQ(empty, "");
+    EXPECT_EQ(world, "World");
+    EXPECT_EQ(hello.data()[hello.length()], '\0');
+    EXPECT_EQ(arena.size(), 10);
+}
+
+TEST(StringArena, ViewsSurviveGrowth)
+{
+    Obelix::StringArena arena;
+    std::vector<std::string_view> views;
+    for (auto ix = 0; ix < 10000; ++ix)
+        views.push_back(arena.add(std::to_string(ix)));
+    auto big = arena.add(std::string(3 * Obelix::StringArena::BlockSize, 'x'));
+    for (auto ix = 0; ix < 10000; ++ix)
+        EXPECT_EQ(views[ix], std::to_string(ix));
+    EXPECT_EQ(big.length(), 3 * Obelix::StringArena::BlockSize);
+}
+
+TEST(StringArena, ClearReusesBlocks)
+{
+    Obelix::StringArena arena;
+    for (auto ix = 0; ix < 10000; ++ix)
+        (void)arena.add("Some token text");
+    auto capacity = arena.capacity();
+    arena.clear();
+    EXPECT_EQ(arena.size(), 0);
+    for (auto ix = 0; ix < 10000; ++ix)
+        EXPECT_EQ(arena.add("Some token text"), "Some token text");
+    EXPECT_EQ(arena.capacity(), capacity);
+}
+
+TEST(StringArena, ReleaseRecyclesBlocks)
+{
+    Obelix::StringArena arena;
+    for (auto ix = 0; ix < 10000; ++ix)
+        (void)arena.add("Some token text");
+    auto mark = arena.mark();
+    auto kept = arena.add("kept");
+    auto size = arena.size();
+    auto capacity = arena.capacity();
+    arena.release(mark);
+    EXPECT_EQ(kept, "kept");
+    EXPECT_LT(arena.size(), size);
+    for (auto round = 0; round < 100; ++round) {
+        for (auto ix = 0; ix < 1000; ++ix)
+            (void)arena.add("Some token text");
+        arena.release(arena.mark());
+    }
+    EXPECT_EQ(arena.capacity(), capacity);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <cctype>
+#include <string>
+#include <unistd.h>
+
+#include <core/SegmentedBuffer.h>
+#include <core/StreamingBuffer.h>
+#include <core/StringBuffer.h>
+#include <gtest/gtest.h>
+
+static Obelix::ByteClass const s_letters = Obelix::ByteClass::matching(isalpha);
+
+/*
+ * Splits the input into words, comments, and runs of anything else, using
+ * only the bulk scans.
+ */
+static std::vector<std::string> split(Obelix::StringBuffer& buffer)
+{
+    std::vector<std::string> ret;
+    while (!buffer.eof()) {
+        buffer.reset();
+        std::string_view scanned;
+        if (buffer.expect("/*")) {
+            scanned = buffer.find("*/");
+            EXPECT_EQ(scanned, buffer.scanned_string().substr(2));
+            buffer.skip(2);
+        } else if (s_letters.contains(buffer.peek())) {
+            scanned = buffer.scan_while(s_letters);
+            EXPECT_EQ(scanned, buffer.scanned_string());
+        } else {
+            buffer.skip();
+            scanned = buffer.scan_until("/abcdefghijklmnopqrstuvwxyz");
+            EXPECT_EQ(scanned, buffer.scanned_string().substr(1));
+        }
+        ret.emplace_back(buffer.scanned_string());
+    }
+    return ret;
+}
+
+static std::string text()
+{
+    std::string ret;
+    for (auto ix = 0u; ix < 40; ++ix) {
+        ret += "word" + std::to_string(ix) + " " + std::string(ix, 'x') + ";\n";
+        if (ix % 5 == 0)
+            ret += "/* comment " + std::string(ix * 2, '*') + " */";
+    }
+    return ret + "/* unclosed";
+}
+
+TEST(StringBufferScan, Scans)
+{
+    Obelix::StringBuffer buffer(std::string("abc  def/* x */ 12"));
+    EXPECT_EQ(buffer.scan_while(s_letters), "abc");
+    EXPECT_EQ(buffer.scan_while(s_letters), "");
+    EXPECT_EQ(buffer.scan_until("/d"), "  ");
+    EXPECT_EQ(buffer.find("*/"), "def/* x ");
+    EXPECT_EQ(buffer.read(2), "*/");
+    EXPECT_EQ(buffer.find("*/"), " 12");
+    EXPECT_TRUE(buffer.eof());
+    EXPECT_EQ(buffer.scan_until("x"), "");
+    EXPECT_EQ(buffer.scanned_string(), "abc  def/* x */ 12");
+}
+
+TEST(StringBufferScan, SameInAllBuffers)
+{
+    auto contents = text();
+    Obelix::StringBuffer plain(contents);
+    auto expected = split(plain);
+    ASSERT_EQ(expected.front(), "word");
+    ASSERT_EQ(expected.back(), "/* unclosed");
+
+    std::vector<std::string> lines;
+    for (size_t pos = 0; pos < contents.length(); pos += 7)
+        lines.push_back(contents.substr(pos, 7));
+    Obelix::SegmentedBuffer segmented(lines, "");
+    EXPECT_EQ(split(segmented), expected);
+
+    int fds[2];
+    ASSERT_EQ(pipe(fds), 0);
+    ASSERT_EQ(write(fds[1], contents.data(), contents.length()), static_cast<ssize_t>(contents.length()));
+    close(fds[1]);
+    Obelix::StreamingBuffer streaming(fds[0], 16);
+    EXPECT_EQ(split(streaming), expected);
+}
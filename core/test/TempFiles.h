@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <core/FileBuffer.h>
+#include <gtest/gtest.h>
+
+/**
+ * Fixture for tests that work on files. Files and directories are created
+ * in the temp directory, under names unique to the process, and removed
+ * after the test.
+ */
+class TempFiles : public ::testing::Test {
+protected:
+    void TearDown() override
+    {
+        std::error_code ignored;
+        for (auto const& path : m_paths)
+            Obelix::fs::remove_all(path, ignored);
+        m_paths.clear();
+    }
+
+    /**
+     * The path of the temp file or directory for name. It is removed after
+     * the test, with everything in it.
+     */
+    Obelix::fs::path temp_path(std::string const& name)
+    {
+        auto ret = Obelix::fs::temp_directory_path() / ("obl_test_" + std::to_string(getpid()) + "_" + name);
+        m_paths.push_back(ret);
+        return ret;
+    }
+
+    /**
+     * Writes contents to the temp file for name, and returns its path.
+     */
+    std::string write(std::string const& name, std::string const& contents)
+    {
+        auto path = temp_path(name);
+        std::ofstream out(path, std::ios::binary);
+        out << contents;
+        return path.string();
+    }
+
+private:
+    std::vector<Obelix::fs::path> m_paths;
+};
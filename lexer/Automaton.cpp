@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <lexer/Automaton.h>
+
+namespace Obelix {
+
+int32_t ScannerAutomaton::add_state()
+{
+    auto ret = static_cast<int32_t>(size());
+    m_transitions.resize(m_transitions.size() + 256, Reject);
+    return ret;
+}
+
+int32_t ScannerAutomaton::accept(Action action)
+{
+    for (auto ix = 0u; ix < m_actions.size(); ++ix) {
+        if (m_actions[ix] == action)
+            return -2 - static_cast<int32_t>(ix);
+    }
+    m_actions.push_back(action);
+    return -1 - static_cast<int32_t>(m_actions.size());
+}
+
+void ScannerAutomaton::transition(int32_t state, unsigned char byte, int32_t target)
+{
+    m_transitions[state * 256 + byte] = target;
+}
+
+bool ScannerAutomaton::stops_on_nul() const
+{
+    for (auto state = 0u; state < size(); ++state) {
+        if (next(static_cast<int32_t>(state), 0) >= 0)
+            return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+#include <lexer/Token.h>
+
+namespace Obelix {
+
+using CharacterSet = std::bitset<256>;
+
+/**
+ * The value Tokenizer::peek() returns for a byte of the input, i.e. the byte
+ * as a (possibly sign-extended) char.
+ */
+constexpr int peek_value(unsigned char byte)
+{
+    return static_cast<char>(byte);
+}
+
+/**
+ * A table-driven description of what a scanner matches, used by LexerDfa to
+ * run all scanners over the input in one pass. Every state has a transition
+ * for each of the 256 byte values. A transition either moves to another
+ * state, consuming the byte, or stops the scanner without consuming the
+ * byte: either rejecting, or accepting the bytes consumed so far as a token.
+ */
+class ScannerAutomaton {
+public:
+    struct Action {
+        TokenCode code { TokenCode::Unknown };
+        bool skip { false };       // Token is dropped, like Tokenizer::skip()
+        bool rewrite { false };    // Token value isn't a slice of the input
+        uint8_t back_off { 0 };    // Bytes to give back, like Tokenizer::partial_rewind()
+        uint8_t trim_front { 0 };  // Bytes stripped from the start of the token value
+        uint8_t trim_back { 0 };   // Bytes stripped from the end of the token value
+
+        bool operator==(Action const&) const = default;
+    };
+
+    static constexpr int32_t Reject = -1;
+
+    [[nodiscard]] static bool is_accept(int32_t target) { return target <= -2; }
+
+    int32_t add_state();
+    int32_t accept(Action);
+    void transition(int32_t state, unsigned char byte, int32_t target);
+
+    [[nodiscard]] int32_t next(int32_t state, unsigned char byte) const { return m_transitions[state * 256 + byte]; }
+    [[nodiscard]] Action const& action(int32_t target) const { return m_actions[-2 - target]; }
+    [[nodiscard]] size_t size() const { return m_transitions.size() / 256; }
+    [[nodiscard]] bool stops_on_nul() const;
+
+    int32_t start { 0 };
+    int32_t start_at_top { 0 };
+
+    /*
+     * Bytes that, when they directly follow a token accepted by this
+     * scanner, are matched by the scanner in the same Scanner::match() call.
+     * Other scanners never get to see those bytes.
+     */
+    CharacterSet chains {};
+
+private:
+    std::vector<int32_t> m_transitions {};
+    std::vector<Action> m_actions {};
+};
+
+}
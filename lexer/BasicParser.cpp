@@ -28,9 +28,9 @@ BasicParser::BasicParser()
 {
 }
 
-ErrorOr<void,SystemError> BasicParser::read_file(std::string const& file_name, BufferLocator* locator)
+ErrorOr<void,SystemError> BasicParser::read_file(std::string const& file_name, BufferLocator* locator, FileBuffer::Options const& options)
 {
-    auto buffer = TRY(FileBuffer::from_file(file_name, locator));
+    auto buffer = TRY(SourceCache::get_cache().get(file_name, locator, options));
 
     m_file_name = file_name;
     m_file_path = buffer->file_path();
@@ -60,9 +60,17 @@ void BasicParser::assign(std::string_view src)
 
 void BasicParser::assign(std::vector<std::string> const& src)
 {
-    // FIXME Use the fact that we know where the newlines are,
-    // for example by using a more flexible buffer design.
-    m_lexer.assign(join(src, '\n'), m_file_name);
+    assign(std::vector<std::string>(src));
+}
+
+void BasicParser::assign(std::vector<std::string>&& src)
+{
+    m_lexer.assign(std::make_shared<SegmentedBuffer>(std::move(src), "\n"), m_file_name);
+}
+
+void BasicParser::borrow(std::vector<std::string> const& src)
+{
+    m_lexer.assign(std::make_shared<SegmentedBuffer>(src, "\n"), m_file_name);
 }
 
 
@@ -7,6 +7,8 @@
 #pragma once
 
 #include <core/FileBuffer.h>
+#include <core/SegmentedBuffer.h>
+#include <core/SourceCache.h>
 #include <lexer/Lexer.h>
 
 namespace Obelix {
@@ -21,12 +23,30 @@ public:
 
     [[nodiscard]] std::string text() const { return m_lexer.buffer()->str(); }
     [[nodiscard]] std::shared_ptr<StringBuffer> const& buffer() const { return m_lexer.buffer(); }
-    ErrorOr<void,SystemError> read_file(std::string const&, BufferLocator* locator = nullptr);
+    /**
+     * Files are read through the process-wide SourceCache, so a file that
+     * was read before and didn't change isn't read again. Files of
+     * FileBuffer::MapThreshold bytes or more are memory mapped, unless
+     * options says otherwise.
+     */
+    ErrorOr<void,SystemError> read_file(std::string const&, BufferLocator* locator = nullptr, FileBuffer::Options const& options = { .map_threshold = FileBuffer::MapThreshold });
     void assign(StringBuffer&&);
     void assign(std::shared_ptr<StringBuffer>);
     void assign(std::string const&);
     void assign(std::string_view);
+
+    /**
+     * Parses the lines as one text, with newlines between them, without
+     * joining them. The lines are copied, unless they are moved in.
+     */
     void assign(std::vector<std::string> const&);
+    void assign(std::vector<std::string>&&);
+
+    /**
+     * Like assign(), but the lines are referenced instead of copied. They
+     * must not change, and must outlive the parser and its tokens.
+     */
+    void borrow(std::vector<std::string> const&);
     [[nodiscard]] std::vector<SyntaxError> const& errors() const { return m_errors; };
     [[nodiscard]] bool has_errors() const { return !m_errors.empty(); }
     Token const& peek();
@@ -4,6 +4,9 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <map>
+
+#include <core/ByteScan.h>
 #include <lexer/Tokenizer.h>
 
 namespace Obelix {
@@ -20,97 +23,221 @@ void CommentScanner::find_eol(Tokenizer& tokenizer)
     }
 }
 
+void CommentScanner::accept_line(Tokenizer& tokenizer)
+{
+    tokenizer.accept(TokenCode::Comment);
+    if (tokenizer.peek() == '\r') {
+        if (tokenizer.peek(1) == '\n') {
+            tokenizer.discard(); // This is the '\r' that we're dropping on the floor
+            tokenizer.push();    // ... and that we're replacing with '\n'
+        } else {
+            tokenizer.push_as('\n'); // Alias the '\r' to '\n'.
+        }
+    } else {
+        tokenizer.push();
+    }
+    tokenizer.accept(TokenCode::NewLine);
+    tokenizer.lock_scanner();
+    m_state = CommentState::NewLine;
+}
+
 void CommentScanner::find_end_marker(Tokenizer& tokenizer)
 {
-    assert(!m_match->end.empty());
-    debug(lexer, "find_end_marker: {}", m_match->end);
-    std::string maybe_end_token {};
-    int ch;
-    for (ch = tokenizer.peek(); ch && (m_state != CommentState::None);) {
-        switch (m_state) {
-        case CommentState::Text:
-        case CommentState::NewLine:
-            if (ch == m_match->end[0]) {
-                maybe_end_token = "";
-                maybe_end_token += (char)ch;
-                m_state = CommentState::EndMarker;
-            } else if (m_split_by_lines && (ch == '\r' || ch == '\n')) {
-                tokenizer.accept(TokenCode::Comment);
-                if (ch == '\r') {
-                    ch = tokenizer.peek(1);
-                    if (ch == '\n') {
-                        tokenizer.discard(); // This is the '\r' that we're dropping on the floor
-                        tokenizer.push();    // ... and that we're replacing with '\n'
-                    } else {
-                        tokenizer.push_as('\n'); // Alias the '\r' to '\n'.
-                    }
-                } else {
-                    tokenizer.push();
-                }
-                tokenizer.accept(TokenCode::NewLine);
-                tokenizer.lock_scanner();
-                m_state = CommentState::NewLine;
-                debug(lexer, "find_end_marker return after newline");
-                return;
-            } else {
-                m_state = CommentState::Text;
-            }
-            tokenizer.push();
-            ch = tokenizer.peek();
+    auto const& end = m_match->end;
+    assert(!end.empty());
+    debug(lexer, "find_end_marker: {}", end);
+
+    /*
+     * Jump to the next byte that could start the end marker, or end the
+     * line if comments are split by lines, and verify from there. The
+     * input ends at a NUL, like it does for Tokenizer::peek().
+     */
+    char const stops[] = { end[0], '\0', '\r', '\n' };
+    auto stops_view = std::string_view(stops, (m_split_by_lines) ? 4 : 2);
+    auto const& buffer = tokenizer.buffer();
+    auto text = buffer.buffer().substr(buffer.position());
+    auto at = [&text](size_t pos) { return (pos < text.length()) ? text[pos] : '\0'; };
+
+    size_t pos = 0;
+    while (true) {
+        auto stop = find_any_of(text.substr(pos), stops_view);
+        pos = (stop != std::string_view::npos) ? pos + stop : text.length();
+        auto ch = at(pos);
+        if (!ch)
             break;
-        case CommentState::EndMarker:
-            maybe_end_token += (char) ch;
-            if ((maybe_end_token.length() == m_match->end.length()) && (maybe_end_token.back() == m_match->end.back())) {
-                /*
-                 * We matched the full end marker. Set the state of the scanner.
-                 */
-                tokenizer.push();
+        if (ch != end[0]) {
+            tokenizer.push(pos);
+            accept_line(tokenizer);
+            debug(lexer, "find_end_marker return after newline");
+            return;
+        }
+
+        /*
+         * Verify the end marker. A character breaking the match is
+         * consumed as comment text, even if it could start a new end
+         * marker. That also means that a one-character end marker never
+         * matches.
+         */
+        size_t matched = 1;
+        for (ch = at(pos + matched); ch; ch = at(pos + matched)) {
+            if ((matched + 1 == end.length()) && (ch == end.back())) {
+                tokenizer.push(pos + matched + 1);
                 tokenizer.accept(TokenCode::Comment);
                 m_state = CommentState::None;
                 tokenizer.unlock_scanner();
-            } else if (m_split_by_lines && (ch == '\r' || ch == '\n')) {
-                tokenizer.accept(TokenCode::Comment);
-                if (ch == '\r') {
-                    ch = tokenizer.peek(1);
-                    if (ch == '\n') {
-                        tokenizer.discard(); // This is the '\r' that we're dropping on the floor
-                        tokenizer.push();    // ... and that we're replacing with '\n'
-                    } else {
-                        tokenizer.push_as('\n'); // Alias the '\r' to '\n'.
-                    }
-                } else {
-                    tokenizer.push();
-                }
-                tokenizer.accept(TokenCode::NewLine);
-                tokenizer.lock_scanner();
-                m_state = CommentState::NewLine;
                 return;
-            } else if (maybe_end_token.back() != m_match->end[maybe_end_token.length() - 1]) {
-                /*
-                 * The match of the end marker was lost. Reset the state. It's possible
-                 * though that this is the start of a new end marker match though.
-                 */
-                tokenizer.push();
-                ch = tokenizer.peek();
-                m_state = CommentState::Text;
-            } else {
-                /*
-                 * Still matching the end marker. Read next character:
-                 */
-                tokenizer.push();
-                ch = tokenizer.peek();
             }
+            if (m_split_by_lines && (ch == '\r' || ch == '\n')) {
+                tokenizer.push(pos + matched);
+                accept_line(tokenizer);
+                return;
+            }
+            if (matched >= end.length() || ch != end[matched])
+                break;
+            ++matched;
+        }
+        if (!ch) {
+            pos += matched;
             break;
-        default:
-            fatal("Unreachable");
         }
+        pos += matched + 1;
     }
-    if (!ch) {
-        tokenizer.accept(TokenCode::Error, "Unterminated comment");
-    }
+    tokenizer.push(pos);
+    tokenizer.accept(TokenCode::Error, "Unterminated comment");
     debug(lexer, "find_end_marker end of function");
 }
 
+std::shared_ptr<Scanner> CommentScanner::clone() const
+{
+    // m_match points into our own markers, and is only set while matching.
+    auto ret = std::make_shared<CommentScanner>(*this);
+    ret->m_state = CommentState::None;
+    ret->m_match = nullptr;
+    return ret;
+}
+
+void CommentScanner::abandon()
+{
+    m_state = CommentState::None;
+    m_match = nullptr;
+}
+
+CharacterSet CommentScanner::start_characters() const
+{
+    CharacterSet ret;
+    for (auto const& marker : m_markers) {
+        if (!marker.start.empty())
+            ret.set(static_cast<unsigned char>(marker.start[0]));
+    }
+    return ret;
+}
+
+std::optional<ScannerAutomaton> CommentScanner::automaton() const
+{
+    /*
+     * Split comments return more than one token from one match() call and
+     * lock the scanner. That can't be expressed as an automaton.
+     */
+    if (m_split_by_lines)
+        return {};
+    for (auto const& marker : m_markers) {
+        if (!marker.eol && marker.end.empty())
+            return {};
+    }
+
+    ScannerAutomaton ret;
+    auto accept_comment = ret.accept({ TokenCode::Comment });
+    auto unterminated = ret.accept({ TokenCode::Error, false, true });
+
+    /*
+     * The states matching the text of the comment, once the start marker
+     * has been matched.
+     */
+    auto body = [&](CommentMarker const& marker) {
+        auto text = ret.add_state();
+        if (marker.eol) {
+            for (auto ix = 0u; ix < 256; ++ix) {
+                int ch = peek_value(ix);
+                ret.transition(text, ix, (!ch || ch == '\r' || ch == '\n') ? accept_comment : text);
+            }
+            return text;
+        }
+        /*
+         * end_marker[n] is the state after matching n characters of the end
+         * marker. Like find_end_marker(), a character that breaks a partial
+         * match is consumed as comment text, and a one-character end marker
+         * never matches.
+         */
+        auto const& end = marker.end;
+        auto done = ret.add_state();
+        std::vector<int32_t> end_marker { text };
+        for (auto len = 1u; len < std::max<size_t>(end.length(), 2); ++len)
+            end_marker.push_back(ret.add_state());
+        for (auto ix = 0u; ix < 256; ++ix) {
+            int ch = peek_value(ix);
+            ret.transition(done, ix, accept_comment);
+            if (!ch) {
+                for (auto state : end_marker)
+                    ret.transition(state, ix, unterminated);
+                continue;
+            }
+            ret.transition(text, ix, (ch == end[0]) ? end_marker[1] : text);
+            for (auto len = 1u; len < end_marker.size(); ++len) {
+                if (len >= end.length() || ch != end[len])
+                    ret.transition(end_marker[len], ix, text);
+                else
+                    ret.transition(end_marker[len], ix, (len + 1 == end.length()) ? done : end_marker[len + 1]);
+            }
+        }
+        return text;
+    };
+
+    /*
+     * The start markers are matched like keywords, except that a marker is
+     * only recognized if no other marker starts with it. Hashpling markers
+     * only match at the top of the input, so there are two sets of start
+     * states.
+     */
+    auto start_states = [&](bool at_top) {
+        struct Prefix {
+            int32_t state;
+            size_t count { 0 };
+            CommentMarker const* marker { nullptr };
+        };
+        std::map<std::string, Prefix> prefixes;
+        prefixes[""] = { ret.add_state() };
+        for (auto const& marker : m_markers) {
+            if (marker.hashpling && !at_top)
+                continue;
+            for (auto len = 1u; len <= marker.start.length(); ++len) {
+                auto prefix = marker.start.substr(0, len);
+                if (!prefixes.contains(prefix))
+                    prefixes[prefix] = { ret.add_state() };
+                prefixes[prefix].count++;
+            }
+            prefixes[marker.start].marker = &marker;
+        }
+        for (auto const& [prefix, p] : prefixes) {
+            if (p.count == 1 && p.marker != nullptr) {
+                auto text = body(*p.marker);
+                for (auto ix = 0u; ix < 256; ++ix)
+                    ret.transition(p.state, ix, ret.next(text, ix));
+                continue;
+            }
+            for (auto ix = 0u; ix < 256; ++ix) {
+                int ch = peek_value(ix);
+                if (auto it = prefixes.find(prefix + (char)ch); ch && it != prefixes.end())
+                    ret.transition(p.state, ix, it->second.state);
+            }
+        }
+        return prefixes[""].state;
+    };
+
+    ret.start = start_states(false);
+    ret.start_at_top = start_states(true);
+    return ret;
+}
+
 void CommentScanner::match(Tokenizer& tokenizer)
 {
     debug(lexer, "CommentScanner m_state = {}", (int)m_state);
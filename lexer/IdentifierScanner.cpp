@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+
 #include <lexer/Tokenizer.h>
 
 namespace Obelix {
@@ -11,72 +13,116 @@ namespace Obelix {
 IdentifierScanner::IdentifierScanner()
     : Scanner(15)
 {
+    build_tables();
 }
 
 IdentifierScanner::IdentifierScanner(Config config)
     : Scanner(15)
     , m_config(std::move(config))
 {
+    build_tables();
 }
 
-bool IdentifierScanner::filter_character(Tokenizer& tokenizer, int ch) const {
-    bool ret;
-
-    if (!ch)
-        return false;
+void IdentifierScanner::build_tables()
+{
+    int (*fold)(int) = nullptr;
+    switch (m_config.alpha) {
+    case IdentifierCharacterClass::FoldToUpper:
+        fold = toupper;
+        break;
+    case IdentifierCharacterClass::FoldToLower:
+        fold = tolower;
+        break;
+    default:
+        break;
+    }
+    for (auto ix = 0u; ix < 256; ++ix) {
+        int ch = peek_value(ix);
+        m_continues[ix] = ch && filter_against(ch, m_config.filter, m_config.alpha, m_config.digits);
+        m_starts[ix] = m_continues[ix] && filter_against(ch, m_config.starts_with, m_config.startswith_alpha, m_config.startswith_digits);
+        m_fold[ix] = static_cast<char>((fold != nullptr) ? fold(ch) : ch);
+        m_folds = m_folds || (m_fold[ix] != static_cast<char>(ix));
+    }
+}
 
-    auto filter_against = [ch](auto filter_against, auto alpha_class, auto digits_allowed) {
-        if (isalpha(ch)) {
-            switch (alpha_class) {
-            case IdentifierCharacterClass::NoAlpha:
-                return false;
-            case IdentifierCharacterClass::OnlyLower:
-                return (bool) islower(ch);
-            case IdentifierCharacterClass::OnlyUpper:
-                return (bool) isupper(ch);
-            default:
-                return true;
-            }
-        } else if (isdigit(ch)) {
-            return digits_allowed;
-        } else if (!filter_against.empty()) {
-            return filter_against.find_first_of(ch) != std::string::npos;
+bool IdentifierScanner::filter_against(int ch, std::string const& filter, IdentifierCharacterClass alpha_class, bool digits_allowed)
+{
+    if (isalpha(ch)) {
+        switch (alpha_class) {
+        case IdentifierCharacterClass::NoAlpha:
+            return false;
+        case IdentifierCharacterClass::OnlyLower:
+            return (bool) islower(ch);
+        case IdentifierCharacterClass::OnlyUpper:
+            return (bool) isupper(ch);
+        default:
+            return true;
         }
-        return true;
-    };
-    ret = filter_against(m_config.filter, m_config.alpha, m_config.digits);
+    } else if (isdigit(ch)) {
+        return digits_allowed;
+    } else if (!filter.empty()) {
+        return filter.find_first_of(ch) != std::string::npos;
+    }
+    return true;
+}
+
+CharacterSet IdentifierScanner::start_characters() const
+{
+    CharacterSet ret;
+    for (auto ix = 0u; ix < 256; ++ix) {
+        if (m_starts[ix])
+            ret.set(ix);
+    }
+    return ret;
+}
 
-    if (ret && tokenizer.current_token().empty()) {
-        ret = filter_against(m_config.starts_with, m_config.startswith_alpha, m_config.startswith_digits);
+std::optional<ScannerAutomaton> IdentifierScanner::automaton() const
+{
+    /*
+     * Identifiers in which case folding changed a character are rebuilt by
+     * the scanner. All others are a slice of the input.
+     */
+    ScannerAutomaton ret;
+    auto start = ret.add_state();
+    auto clean = ret.add_state();
+    auto folded = ret.add_state();
+    auto accept_clean = ret.accept({ m_config.code });
+    auto accept_folded = ret.accept({ m_config.code, false, true });
+    for (auto ix = 0u; ix < 256; ++ix) {
+        auto changes = m_fold[ix] != static_cast<char>(ix);
+        ret.transition(start, ix, (m_starts[ix]) ? ((changes) ? folded : clean) : ScannerAutomaton::Reject);
+        ret.transition(clean, ix, (m_continues[ix]) ? ((changes) ? folded : clean) : accept_clean);
+        ret.transition(folded, ix, (m_continues[ix]) ? folded : accept_folded);
     }
+    ret.start = ret.start_at_top = start;
     return ret;
 }
 
 void IdentifierScanner::match(Tokenizer& tokenizer)
 {
-    int ch;
-    bool identifier_found { false };
+    auto const& buffer = tokenizer.buffer();
+    auto text = buffer.buffer().substr(buffer.position());
+    if (text.empty() || !m_starts[static_cast<unsigned char>(text[0])])
+        return;
+    size_t length = 1;
+    while (length < text.length() && m_continues[static_cast<unsigned char>(text[length])])
+        ++length;
 
-    for (ch = tokenizer.peek(); filter_character(tokenizer, ch); ch = tokenizer.peek()) {
-        identifier_found = true;
-        switch (m_config.alpha) {
-        case IdentifierCharacterClass::CaseSensitive:
-        case IdentifierCharacterClass::OnlyLower:
-        case IdentifierCharacterClass::OnlyUpper:
-            tokenizer.push();
-            break;
-        case IdentifierCharacterClass::FoldToUpper:
-            tokenizer.push_as(toupper(ch));
-            break;
-        case IdentifierCharacterClass::FoldToLower:
-            tokenizer.push_as(tolower(ch));
-            break;
-        default:
-            break;
+    auto identifier = text.substr(0, length);
+    tokenizer.push(length);
+    if (m_folds) {
+        auto it = std::find_if(identifier.begin(), identifier.end(), [this](char ch) {
+            return m_fold[static_cast<unsigned char>(ch)] != ch;
+        });
+        if (it != identifier.end()) {
+            auto folded = tokenizer.arena().allocate(length);
+            for (auto ix = 0u; ix < length; ++ix)
+                folded[ix] = m_fold[static_cast<unsigned char>(identifier[ix])];
+            tokenizer.accept(m_config.code, std::string_view(folded, length));
+            return;
         }
     }
-    if (identifier_found)
-        tokenizer.accept(m_config.code);
+    tokenizer.accept(m_config.code, identifier);
 }
 
 }
@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+
 #include <core/Logging.h>
 #include <lexer/Tokenizer.h>
 
@@ -19,49 +21,139 @@ void KeywordScanner::add_keyword(TokenCode keyword_code, std::string keyword_tok
     auto& ch = keyword_token.back();
     keyword.is_operator = (!isalnum(ch) && (ch != '_'));
     m_keywords.push_back(keyword);
-    std::sort(m_keywords.begin(), m_keywords.end(), [](Keyword const& a, Keyword const& b) {
-        return a.token < b.token;
+    m_nodes.clear();
+}
+
+void KeywordScanner::build_trie()
+{
+    std::vector<uint32_t> order(m_keywords.size());
+    for (auto ix = 0u; ix < order.size(); ++ix)
+        order[ix] = ix;
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return m_keywords[a].token < m_keywords[b].token;
     });
+    m_nodes.clear();
+    m_edge_bytes.clear();
+    m_edge_targets.clear();
+    build_node(order, 0, order.size(), 0);
 }
 
-void KeywordScanner::match_character(int ch)
+uint32_t KeywordScanner::build_node(std::vector<uint32_t> const& order, size_t lo, size_t hi, size_t depth)
 {
-    if (m_state == KeywordScannerState::Init) {
-        m_match_min = 0;
-        m_match_max = m_keywords.size();
-        m_scanned = "";
+    auto id = static_cast<uint32_t>(m_nodes.size());
+    m_nodes.emplace_back();
+    m_nodes[id].count = static_cast<uint32_t>(hi - lo);
+
+    /*
+     * The keywords in [lo, hi) are sorted and share the first depth bytes.
+     * The ones that end here come first; if the same keyword was added more
+     * than once, the last one added wins.
+     */
+    for (; lo < hi && m_keywords[order[lo]].token.length() == depth; ++lo)
+        m_nodes[id].keyword = static_cast<int>(order[lo]);
+
+    std::vector<std::pair<size_t, size_t>> children;
+    for (auto ix = lo; ix < hi; ++ix) {
+        if (ix == lo || m_keywords[order[ix]].token[depth] != m_keywords[order[ix - 1]].token[depth])
+            children.emplace_back(ix, ix);
+        children.back().second = ix + 1;
     }
-    if (!m_case_sensitive)
-        ch = toupper(ch);
-    m_scanned += (char)ch;
-    auto len = m_scanned.length();
-    auto fullmatch = -1;
-
-    for (auto ix = m_match_min; ix < m_match_max; ix++) {
-        std::string kw = m_keywords[ix].token;
-        auto cmp = kw.compare(m_scanned);
-        if (cmp < 0) {
-            m_match_min = ix + 1;
-        } else if (cmp == 0) {
-            fullmatch = (int)ix;
-        } else { /* cmp > 0 */
-            if (m_scanned.substr(0, len) != kw.substr(0, len)) {
-                m_match_max = ix;
-                break;
+    auto first_edge = static_cast<uint32_t>(m_edge_bytes.size());
+    m_nodes[id].first_edge = first_edge;
+    m_nodes[id].edges = static_cast<uint32_t>(children.size());
+    m_edge_bytes.resize(first_edge + children.size());
+    m_edge_targets.resize(first_edge + children.size());
+    for (auto ix = 0u; ix < children.size(); ++ix) {
+        auto [child_lo, child_hi] = children[ix];
+        m_edge_bytes[first_edge + ix] = static_cast<unsigned char>(m_keywords[order[child_lo]].token[depth]);
+        auto target = build_node(order, child_lo, child_hi, depth + 1);
+        m_edge_targets[first_edge + ix] = target;
+    }
+    return id;
+}
+
+int KeywordScanner::child(uint32_t node, int ch) const
+{
+    auto const& n = m_nodes[node];
+    auto begin = m_edge_bytes.begin() + n.first_edge;
+    auto end = begin + n.edges;
+    auto it = std::lower_bound(begin, end, static_cast<unsigned char>(ch));
+    if (it == end || *it != static_cast<unsigned char>(ch))
+        return -1;
+    return static_cast<int>(m_edge_targets[it - m_edge_bytes.begin()]);
+}
+
+CharacterSet KeywordScanner::start_characters() const
+{
+    CharacterSet ret;
+    for (auto const& keyword : m_keywords) {
+        auto ch = static_cast<unsigned char>(keyword.token[0]);
+        ret.set(ch);
+        if (!m_case_sensitive)
+            ret.set(static_cast<unsigned char>(tolower(ch)));
+    }
+    return ret;
+}
+
+void KeywordScanner::freeze()
+{
+    if (!frozen())
+        build_trie();
+}
+
+std::optional<ScannerAutomaton> KeywordScanner::automaton() const
+{
+    if (!frozen()) {
+        auto copy = *this;
+        copy.freeze();
+        return copy.automaton();
+    }
+
+    /*
+     * One state per trie node, with the same numbering.
+     */
+    ScannerAutomaton ret;
+    for (auto const& node : m_nodes) {
+        auto state = ret.add_state();
+        for (auto ix = 0u; ix < 256; ++ix) {
+            int ch = peek_value(ix);
+            if (auto next = child(state, (m_case_sensitive) ? ch : toupper(ch)); ch && next >= 0) {
+                ret.transition(state, ix, next);
+                continue;
+            }
+            if (node.keyword < 0)
+                continue;
+            auto const& keyword = m_keywords[node.keyword];
+            if (!ch) {
+                /*
+                 * At the end of the input only an unambiguous full match
+                 * (KeywordScannerState::FullMatch) is accepted.
+                 */
+                if (node.count == 1)
+                    ret.transition(state, ix, ret.accept({ keyword.token_code }));
+            } else if (keyword.is_operator || (!isalnum(ch) && (ch != '_'))) {
+                ret.transition(state, ix, ret.accept({ keyword.token_code }));
             }
         }
     }
+    if (m_nodes.empty())
+        ret.add_state();
+    return ret;
+}
 
-    if (m_match_min > m_match_max) {
-        m_matchcount = 0;
-    } else {
-        m_matchcount = m_match_max - m_match_min;
-    }
+void KeywordScanner::match_character(int ch)
+{
+    if (m_state == KeywordScannerState::Init)
+        m_node = 0;
+    if (!m_case_sensitive)
+        ch = toupper(ch);
+    auto next = child(m_node, ch);
+    auto matchcount = (next >= 0) ? m_nodes[next].count : 0u;
 
     /*
      * Determine new state.
      */
-    switch (m_matchcount) {
+    switch (matchcount) {
     case 0:
         /*
          * No matches. This means that either there wasn't any match at all, or
@@ -102,21 +194,23 @@ void KeywordScanner::match_character(int ch)
          * Only one match. If it's a full match, i.e. the token matches the
          * keyword, we have a full match. Otherwise it's a prefix match.
          */
-        m_fullmatch = fullmatch;
-        m_state = (fullmatch >= 0)
+        m_node = next;
+        m_fullmatch = m_nodes[next].keyword;
+        m_state = (m_fullmatch >= 0)
             ? KeywordScannerState::FullMatch
             : KeywordScannerState::PrefixMatched;
         break;
 
-    default: /* m_matchcount > 1 */
+    default: /* matchcount > 1 */
 
         /*
          * More than one match. If one of them is a full match, i.e. the token
          * matches exactly the keyword, it's a full-and-prefix match, otherwise
          * it's a prefixes-match.
          */
-        m_fullmatch = fullmatch;
-        m_state = (fullmatch >= 0)
+        m_node = next;
+        m_fullmatch = m_nodes[next].keyword;
+        m_state = (m_fullmatch >= 0)
             ? KeywordScannerState::FullMatchAndPrefixes
             : KeywordScannerState::PrefixesMatched;
         break;
@@ -126,7 +220,7 @@ void KeywordScanner::match_character(int ch)
 void KeywordScanner::reset()
 {
     m_state = KeywordScannerState::Init;
-    m_matchcount = 0;
+    m_node = 0;
     m_fullmatch = -1;
 }
 
@@ -134,6 +228,7 @@ void KeywordScanner::match(Tokenizer& tokenizer)
 {
     if (m_keywords.empty())
         return;
+    freeze();
 
     reset();
     bool carry_on { true };
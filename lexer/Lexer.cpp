@@ -4,6 +4,11 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <algorithm>
+#include <limits>
+#include <thread>
+#include <typeinfo>
+
 #include <lexer/Lexer.h>
 
 namespace Obelix {
@@ -11,55 +16,89 @@ namespace Obelix {
 logging_category(lexer);
 
 Lexer::Lexer(char const* text, std::string file_name)
-    : m_file_name(std::move(file_name))
+    : m_file_id(SourceFiles::intern(file_name))
     , m_buffer(new StringBuffer(text))
 {
 }
 
 Lexer::Lexer(StringBuffer& text, std::string file_name)
-    : m_file_name(std::move(file_name))
+    : m_file_id(SourceFiles::intern(file_name))
     , m_buffer(new StringBuffer(text))
 {
 }
 
+Lexer::Lexer(std::shared_ptr<LexerSpec const> const& spec)
+    : m_buffer(std::make_shared<StringBuffer>())
+    , m_filtered_codes(spec->filtered_codes())
+    , m_engine(spec->engine())
+{
+    auto scanners = spec->instantiate_scanners();
+    m_scanners.insert(scanners.begin(), scanners.end());
+    if (m_engine == LexerEngine::Dfa)
+        m_dfa = spec->instantiate_dfa(scanners);
+}
+
+std::shared_ptr<LexerSpec const> Lexer::spec() const
+{
+    return std::make_shared<LexerSpec const>(m_scanners, m_filtered_codes, m_engine);
+}
+
 std::shared_ptr<Scanner> Lexer::add_scanner(std::string name, CustomScanner::Match match, int priority)
 {
     auto scanner = std::make_shared<CustomScanner>(std::move(name), std::move(match), priority);
     m_scanners.insert(std::dynamic_pointer_cast<Scanner>(scanner));
+    m_dfa.reset();
+    m_reconfigured = true;
     return scanner;
 }
 
 
 void Lexer::assign(char const* text, std::string file_name, bool take_ownership)
 {
-    m_file_name = std::move(file_name);
-    m_buffer->assign(text, take_ownership);
+    m_file_id = SourceFiles::intern(file_name);
+    own_buffer().assign(text, take_ownership);
     invalidate();
 }
 
 void Lexer::assign(std::string text, std::string file_name)
 {
-    m_file_name = std::move(file_name);
-    m_buffer->assign(std::move(text));
+    m_file_id = SourceFiles::intern(file_name);
+    own_buffer().assign(std::move(text));
     invalidate();
 }
 
 void Lexer::assign(StringBuffer&& buffer, std::string file_name)
 {
-    m_file_name = std::move(file_name);
-    m_buffer = std::make_shared<StringBuffer>(buffer);
+    m_file_id = SourceFiles::intern(file_name);
+    own_buffer().assign(std::move(buffer));
+    invalidate();
 }
 
 void Lexer::assign(std::shared_ptr<StringBuffer> buffer, std::string file_name)
 {
-    m_file_name = std::move(file_name);
+    m_file_id = SourceFiles::intern(file_name);
     m_buffer = std::move(buffer);
+    invalidate();
 }
 
 void Lexer::assign(std::string_view buffer, std::string file_name)
 {
-    m_file_name = std::move(file_name);
-    m_buffer = std::make_shared<StringBuffer>(buffer);
+    m_file_id = SourceFiles::intern(file_name);
+    own_buffer().assign(buffer);
+    invalidate();
+}
+
+/*
+ * New text is assigned to the buffer in place, so that a tokenizer that is
+ * kept can go on working on it. That can't be done to a buffer that was
+ * passed in through assign(std::shared_ptr<StringBuffer>): it may be shared,
+ * or a subclass that gets its text elsewhere, like a StreamingBuffer.
+ */
+StringBuffer& Lexer::own_buffer()
+{
+    if (m_buffer.use_count() > 1 || typeid(*m_buffer) != typeid(StringBuffer))
+        m_buffer = std::make_shared<StringBuffer>();
+    return *m_buffer;
 }
 
 std::shared_ptr<StringBuffer> const& Lexer::buffer() const
@@ -71,13 +110,209 @@ std::vector<Token> const& Lexer::tokenize(char const* text, std::string file_nam
 {
     if (text != nullptr)
         assign(text, std::move(file_name), take_ownership);
-    Tokenizer tokenizer(*m_buffer, m_file_name);
-    tokenizer.add_scanners(m_scanners);
-    tokenizer.filter_codes(m_filtered_codes);
-    tokenizer.tokenize(m_tokens);
+    pull(std::numeric_limits<size_t>::max());
     return m_tokens;
 }
 
+/*
+ * Run the tokenizer until there are at least size tokens in m_tokens, or
+ * until it reached the end of the buffer.
+ */
+void Lexer::pull(size_t size)
+{
+    /*
+     * A tokenizer kept from a previous text hasn't produced any tokens of
+     * this one yet, so the text can still be split.
+     */
+    if (m_tokens.empty() && !m_streaming && size == std::numeric_limits<size_t>::max() && tokenize_parallel())
+        return;
+    if (m_tokenizer == nullptr) {
+        m_reconfigured = false;
+        m_tokenizer = std::make_shared<Tokenizer>(*m_buffer, m_file_id);
+        m_tokenizer->add_scanners(m_scanners);
+        m_tokenizer->filter_codes(m_filtered_codes);
+        m_tokenizer->arena(m_arena);
+        if (m_engine == LexerEngine::Dfa) {
+            if (!m_dfa.has_value())
+                m_dfa = m_tokenizer->compile_dfa();
+            m_tokenizer->use_dfa(m_dfa.value());
+        }
+    }
+    if (m_tokens.size() >= size)
+        return;
+    if (m_streaming) {
+        auto mark = m_arena->mark();
+        if (m_arena_marks.empty() || m_arena_marks.back().second != mark)
+            m_arena_marks.emplace_back(m_released + m_tokens.size(), mark);
+    }
+    m_tokenizer->tokenize(m_tokens, size);
+}
+
+/*
+ * Tokenize the buffer in chunks on separate threads. Every chunk but the
+ * first guesses that it starts between two tokens, and is tokenized until it
+ * is past the start of the next chunk, recording its sync points. The chunks
+ * are then stitched together in order: if the tokenizer that produced the
+ * tokens so far stopped at a sync point of the next chunk, that chunk made
+ * the right guess from there on and its tokens are taken over. Otherwise the
+ * chunk is tokenized again by continuing the current tokenizer. Tokens
+ * store offsets into the whole buffer, so there are no positions to fix up.
+ *
+ * Returns false, without doing anything, if the buffer is too small to be
+ * split, if it doesn't hold the whole input, or if a scanner can't be
+ * cloned.
+ */
+bool Lexer::tokenize_parallel()
+{
+    if (m_buffer->more() || m_buffer->base() != 0)
+        return false;
+    auto const& text = m_buffer->buffer();
+    auto num_chunks = std::min(m_threads, text.length() / m_min_chunk_size);
+    if (num_chunks < 2)
+        return false;
+
+    std::vector<size_t> starts { 0 };
+    for (auto ix = 1u; ix < num_chunks; ++ix) {
+        auto eol = text.find('\n', std::max(starts.back(), ix * (text.length() / num_chunks)));
+        if (eol == std::string_view::npos || eol + 1 >= text.length())
+            break;
+        if (eol + 1 > starts.back())
+            starts.push_back(eol + 1);
+    }
+    if (starts.size() < 2)
+        return false;
+    starts.push_back(text.length());
+
+    struct Chunk {
+        std::shared_ptr<Tokenizer> tokenizer;
+        std::vector<Token> tokens;
+        std::vector<Tokenizer::SyncPoint> sync_points;
+    };
+    std::vector<Chunk> chunks(starts.size() - 1);
+    for (auto ix = 0u; ix < chunks.size(); ++ix) {
+        std::set<std::shared_ptr<Scanner>> scanners;
+        for (auto const& scanner : m_scanners) {
+            scanner->freeze();
+            auto clone = scanner->clone();
+            if (clone == nullptr) {
+                debug(lexer, "Scanner '{}' can't be cloned. Not tokenizing in parallel", scanner->name());
+                return false;
+            }
+            scanners.insert(clone);
+        }
+        auto& chunk = chunks[ix];
+        chunk.tokenizer = std::make_shared<Tokenizer>(*m_buffer, starts[ix], m_file_id);
+        chunk.tokenizer->add_scanners(scanners);
+        chunk.tokenizer->filter_codes(m_filtered_codes);
+        if (ix == 0) {
+            chunk.tokenizer->arena(m_arena);
+        } else {
+            chunk.tokenizer->arena(m_chunk_arenas.emplace_back(std::make_shared<StringArena>()));
+        }
+        chunk.sync_points.push_back({ starts[ix], 0 });
+    }
+
+    debug(lexer, "Tokenizing {} bytes in {} chunks", text.length(), chunks.size());
+    auto run = [&chunks, &starts](size_t ix) {
+        auto& chunk = chunks[ix];
+        chunk.tokenizer->tokenize_until(chunk.tokens, starts[ix + 1], &chunk.sync_points);
+    };
+    std::vector<std::thread> threads;
+    for (auto ix = 1u; ix < chunks.size(); ++ix)
+        threads.emplace_back(run, ix);
+    run(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    m_tokens = std::move(chunks[0].tokens);
+    auto current = chunks[0].tokenizer;
+    for (auto ix = 1u; ix < chunks.size() && current->state() != TokenizerState::Done; ++ix) {
+        auto& chunk = chunks[ix];
+        auto position = current->position();
+        auto sync_point = std::lower_bound(chunk.sync_points.begin(), chunk.sync_points.end(), position,
+            [](Tokenizer::SyncPoint const& sp, size_t offset) { return sp.offset < offset; });
+        if (current->synchronized() && sync_point != chunk.sync_points.end() && sync_point->offset == position) {
+            m_tokens.insert(m_tokens.end(), chunk.tokens.begin() + static_cast<long>(sync_point->tokens), chunk.tokens.end());
+            current = chunk.tokenizer;
+        } else {
+            debug(lexer, "Chunk {} started inside a token. Tokenizing it again from offset {}", ix, position);
+            current->tokenize_until(m_tokens, starts[ix + 1]);
+        }
+    }
+    current->tokenize(m_tokens, std::numeric_limits<size_t>::max());
+#ifdef OBL_LEXER_STATISTICS
+    if (m_tokenizer != nullptr)
+        m_statistics.merge(m_tokenizer->statistics());
+    for (auto const& chunk : chunks) {
+        if (chunk.tokenizer != current)
+            m_statistics.merge(chunk.tokenizer->statistics());
+    }
+#endif
+    m_tokenizer = current;
+    m_chunks = chunks.size();
+    return true;
+}
+
+TokenizerStatistics Lexer::statistics() const
+{
+#ifdef OBL_LEXER_STATISTICS
+    auto ret = m_statistics;
+    if (m_tokenizer != nullptr)
+        ret.merge(m_tokenizer->statistics());
+    return ret;
+#else
+    return {};
+#endif
+}
+
+void Lexer::reset_statistics()
+{
+#ifdef OBL_LEXER_STATISTICS
+    m_statistics = {};
+    if (m_tokenizer != nullptr)
+        m_tokenizer->reset_statistics();
+#endif
+}
+
+void Lexer::log_statistics() const
+{
+    info(lexer, "Scanner statistics:\n{}", statistics().to_string());
+}
+
+/*
+ * In streaming mode, drop the tokens before the current one and before the
+ * oldest bookmark once there are enough of them to make it worthwhile.
+ * Moving a Token is a memcpy, so this is cheap. The arena blocks and the
+ * line starts that only released tokens refer to are given up as well,
+ * unless a copy of this Lexer shares the arena.
+ */
+void Lexer::release_consumed()
+{
+    auto keep_from = m_current;
+    for (auto bookmark : m_bookmarks)
+        keep_from = std::min(keep_from, bookmark);
+    if (keep_from < StreamingWindow)
+        return;
+    m_tokens.erase(m_tokens.begin(), m_tokens.begin() + static_cast<long>(keep_from));
+    m_current -= keep_from;
+    for (auto& bookmark : m_bookmarks)
+        bookmark -= keep_from;
+    m_released += keep_from;
+
+    size_t release_before = 0;
+    while (!m_arena_marks.empty() && m_arena_marks.front().first <= m_released) {
+        release_before = m_arena_marks.front().second;
+        m_arena_marks.pop_front();
+    }
+    if (release_before > 0) {
+        m_arena_marks.emplace_front(m_released, release_before);
+        if (m_arena.use_count() == ((m_tokenizer != nullptr) ? 2 : 1))
+            m_arena->release(release_before);
+    }
+    if (!m_tokens.empty())
+        m_buffer->discard_lines(m_tokens.front().start_index());
+}
+
 std::vector<Token> const& Lexer::tokens() const
 {
     return m_tokens;
@@ -85,26 +320,68 @@ std::vector<Token> const& Lexer::tokens() const
 
 void Lexer::invalidate()
 {
+    /*
+     * Keep the tokenizer, with its copies of the scanners and its dispatch
+     * table, if it still works on our buffer with our configuration. That
+     * makes lexing a new text with the same Lexer allocation free, once the
+     * token vector and the arena are large enough.
+     */
+    if (m_tokenizer != nullptr && !m_reconfigured && m_tokenizer.use_count() == 1 && &m_tokenizer->buffer() == m_buffer.get()) {
+        m_tokenizer->restart(m_file_id);
+    } else {
+#ifdef OBL_LEXER_STATISTICS
+        if (m_tokenizer != nullptr)
+            m_statistics.merge(m_tokenizer->statistics());
+#endif
+        m_tokenizer.reset();
+    }
     m_tokens.clear();
     m_current = 0;
+    m_released = 0;
+    m_arena_marks.clear();
+    m_bookmarks.clear();
+    m_chunk_arenas.clear();
+    m_chunks = 1;
+    /*
+     * Reuse the arena's blocks, unless a copy of this Lexer still has tokens
+     * pointing into them. A tokenizer we kept holds a reference as well.
+     */
+    if (m_arena.use_count() == ((m_tokenizer != nullptr) ? 2 : 1)) {
+        m_arena->clear();
+    } else {
+        m_arena = std::make_shared<StringArena>();
+        if (m_tokenizer != nullptr)
+            m_tokenizer->arena(m_arena);
+    }
 }
 
 void Lexer::rewind()
 {
+    oassert(m_released == 0, "Cannot rewind a streaming Lexer that released tokens");
     m_current = 0;
 }
 
 Token const& Lexer::peek(size_t how_many)
 {
-    if (m_tokens.empty())
-        tokenize();
+    if (m_current + how_many >= m_tokens.size())
+        pull((m_streaming) ? m_current + how_many + 1 : std::numeric_limits<size_t>::max());
     oassert(m_current + how_many < m_tokens.size(), "Token buffer underflow");
     return m_tokens[m_current + how_many];
 }
 
 Token const& Lexer::lex()
 {
-    auto const& ret = peek(0);
+    if (m_streaming) {
+        release_consumed();
+        pull(m_current + 2);
+    }
+    (void)peek(0);
+    /*
+     * The caller may keep a copy of the token after this Lexer moves on to
+     * another text, so it gets its own line and column numbers.
+     */
+    auto& ret = m_tokens[m_current];
+    ret.resolve();
     if (m_current < (m_tokens.size() - 1))
         m_current++;
     return ret;
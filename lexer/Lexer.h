@@ -6,8 +6,11 @@
 
 #pragma once
 
+#include <algorithm>
+#include <deque>
 #include <set>
 
+#include <lexer/LexerSpec.h>
 #include <lexer/Tokenizer.h>
 
 namespace Obelix {
@@ -17,6 +20,18 @@ public:
     explicit Lexer(char const* = nullptr, std::string = {});
     explicit Lexer(StringBuffer&, std::string = {});
 
+    /**
+     * A Lexer configured by spec, with its own copies of the scanners. It
+     * can be configured further without affecting spec.
+     */
+    explicit Lexer(std::shared_ptr<LexerSpec const> const& spec);
+
+    /**
+     * A frozen copy of the current configuration, to create Lexers from,
+     * for example one for every thread.
+     */
+    [[nodiscard]] std::shared_ptr<LexerSpec const> spec() const;
+
     template<typename... Args>
     void filter_codes(TokenCode code, Args&&... args)
     {
@@ -26,7 +41,79 @@ public:
 
     void filter_codes()
     {
+        m_reconfigured = true;
+    }
+
+    void engine(LexerEngine engine)
+    {
+        m_engine = engine;
+        m_reconfigured = true;
     }
+    [[nodiscard]] LexerEngine engine() const { return m_engine; }
+
+    /**
+     * In streaming mode peek() and lex() only run the tokenizer as far as
+     * needed for the requested lookahead, and tokens before the current
+     * one and before the oldest mark() are released. Memory use then
+     * depends on the lookahead instead of on the size of the input, but
+     * tokens() only holds the tokens that weren't released yet, rewind()
+     * only works until the first release, and a Token reference returned
+     * by peek() or lex() is only valid until the next call to one of them.
+     * tokenize() still tokenizes the whole buffer.
+     *
+     * To lex input that doesn't fit in memory, assign a StreamingBuffer.
+     * Its window moves, so token text is copied to the arena. The arena
+     * blocks holding only released tokens are recycled, and the lines
+     * before the oldest token held are dropped from the line index, so
+     * released tokens can't be located anymore.
+     */
+    void streaming(bool streaming) { m_streaming = streaming; }
+    [[nodiscard]] bool streaming() const { return m_streaming; }
+
+    /**
+     * In streaming mode, the number of consumed tokens that are held before
+     * they are released.
+     */
+    static constexpr size_t StreamingWindow = 1024;
+
+    /**
+     * Tokenize large buffers on up to the given number of threads. The
+     * buffer is split at line ends into chunks of at least min_chunk_size
+     * bytes, which are tokenized at the same time with copies of the
+     * scanners, using the Scanners engine. A chunk that turns out to start
+     * inside a token, for example a string or a block comment, is tokenized
+     * again from where the previous chunk really ended, so the tokens are
+     * always the same as those of a single-threaded run. Only used when the
+     * whole buffer is tokenized in one go, so not in streaming mode, and
+     * only if all scanners can be cloned.
+     */
+    void parallel(size_t threads, size_t min_chunk_size = ParallelChunkSize)
+    {
+        m_threads = threads;
+        m_min_chunk_size = std::max(min_chunk_size, size_t { 1 });
+    }
+    [[nodiscard]] size_t parallel() const { return m_threads; }
+
+    /**
+     * The number of chunks the current text was tokenized in, or 1 if it
+     * was tokenized on one thread.
+     */
+    [[nodiscard]] size_t chunks() const { return m_chunks; }
+
+    static constexpr size_t ParallelChunkSize = 256 * 1024;
+
+    /**
+     * Per-scanner counters and timings of all tokenizing done since the
+     * Lexer was created or since reset_statistics(). Always empty unless
+     * the lexer is built with OBL_LEXER_STATISTICS.
+     */
+    [[nodiscard]] TokenizerStatistics statistics() const;
+    void reset_statistics();
+
+    /**
+     * Logs statistics() to the lexer logging category.
+     */
+    void log_statistics() const;
 
     void assign(char const* buffer, std::string file_name={}, bool take_ownership=false);
     void assign(std::string buffer, std::string = {});
@@ -50,6 +137,8 @@ public:
     {
         auto ret = std::make_shared<ScannerClass>(std::forward<Args>(args)...);
         m_scanners.insert(std::dynamic_pointer_cast<Scanner>(ret));
+        m_dfa.reset();
+        m_reconfigured = true;
         return ret;
     }
 
@@ -59,14 +148,51 @@ public:
     void discard_mark();
     void rewind_to_mark();
 
+    /**
+     * The arena holding token text that isn't a slice of the buffer.
+     */
+    [[nodiscard]] StringArena const& arena() const { return *m_arena; }
+
 private:
-    std::string m_file_name;
+    StringBuffer& own_buffer();
+    void pull(size_t);
+    bool tokenize_parallel();
+    void release_consumed();
+
+    FileId m_file_id { SourceFiles::NoFile };
     std::shared_ptr<StringBuffer> m_buffer;
     std::vector<Token> m_tokens {};
+    // Token text that isn't a slice of m_buffer, like strings with escapes.
+    std::shared_ptr<StringArena> m_arena { std::make_shared<StringArena>() };
     size_t m_current { 0 };
     std::vector<size_t> m_bookmarks {};
     std::unordered_set<TokenCode> m_filtered_codes {};
     std::set<std::shared_ptr<Scanner>> m_scanners {};
+    LexerEngine m_engine { LexerEngine::Scanners };
+    // Kept when a new text is assigned, unless the Lexer was reconfigured.
+    std::shared_ptr<Tokenizer> m_tokenizer {};
+    bool m_reconfigured { false };
+    bool m_streaming { false };
+    size_t m_released { 0 };
+    // In streaming mode, pairs of a token count, including released
+    // tokens, and the arena mark taken when that many tokens were produced.
+    // Once those tokens are released, the arena blocks before the mark
+    // only hold released token text.
+    std::deque<std::pair<size_t, size_t>> m_arena_marks {};
+    size_t m_threads { 1 };
+    size_t m_min_chunk_size { ParallelChunkSize };
+    size_t m_chunks { 1 };
+#ifdef OBL_LEXER_STATISTICS
+    // Collected by tokenizers that were discarded.
+    TokenizerStatistics m_statistics {};
+#endif
+    // The arenas of the chunks of a parallel run, other than the first.
+    std::vector<std::shared_ptr<StringArena>> m_chunk_arenas {};
+
+    // Compiled on the first tokenize() with the Dfa engine. Holds nullptr if
+    // the scanners can't be compiled. Scanners reconfigured after that
+    // won't be picked up.
+    std::optional<std::shared_ptr<LexerDfa>> m_dfa {};
 };
 
 }
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <lexer/LexerDfa.h>
+#include <lexer/Tokenizer.h>
+
+namespace Obelix {
+
+extern_logging_category(lexer);
+
+std::shared_ptr<LexerDfa> LexerDfa::compile(std::vector<std::shared_ptr<Scanner>> const& scanners)
+{
+    if (scanners.size() > 64) {
+        debug(lexer, "Cannot compile DFA for more than 64 scanners");
+        return nullptr;
+    }
+    std::vector<ScannerAutomaton> automata;
+    for (auto const& scanner : scanners) {
+        auto automaton = scanner->automaton();
+        if (!automaton.has_value()) {
+            debug(lexer, "Cannot compile DFA: scanner '{}' has no automaton", scanner->name());
+            return nullptr;
+        }
+        if (!automaton->stops_on_nul()) {
+            debug(lexer, "Cannot compile DFA: automaton of scanner '{}' runs past the end of the input", scanner->name());
+            return nullptr;
+        }
+        automata.push_back(std::move(automaton.value()));
+    }
+
+    /*
+     * A scanner that matches a chained token in the same match() call hides
+     * those bytes from the scanners that precede it. If one of those could
+     * start a token with them the DFA would pick a different scanner.
+     */
+    for (auto ix = 0u; ix < automata.size(); ++ix) {
+        if (automata[ix].chains.none())
+            continue;
+        for (auto preceding = 0u; preceding < ix; ++preceding) {
+            if ((scanners[preceding]->start_characters() & automata[ix].chains).any()) {
+                debug(lexer, "Cannot compile DFA: scanner '{}' chains tokens scanner '{}' can start with",
+                    scanners[ix]->name(), scanners[preceding]->name());
+                return nullptr;
+            }
+        }
+    }
+    return std::shared_ptr<LexerDfa>(new LexerDfa(scanners, std::move(automata)));
+}
+
+LexerDfa::LexerDfa(std::vector<std::shared_ptr<Scanner>> scanners, std::vector<ScannerAutomaton> automata)
+    : m_scanners(std::move(scanners))
+    , m_automata(std::move(automata))
+    , m_lengths(m_scanners.size(), 0)
+{
+    std::vector<int32_t> start;
+    std::vector<int32_t> start_at_top;
+    for (auto const& automaton : m_automata) {
+        start.push_back(automaton.start);
+        start_at_top.push_back(automaton.start_at_top);
+    }
+    m_start = state_for(start);
+    m_start_at_top = state_for(start_at_top);
+}
+
+std::shared_ptr<LexerDfa> LexerDfa::clone(std::vector<std::shared_ptr<Scanner>> scanners) const
+{
+    oassert(scanners.size() == m_scanners.size(), "LexerDfa::clone() needs as many scanners as the original");
+    auto ret = std::shared_ptr<LexerDfa>(new LexerDfa(*this));
+    ret->m_scanners = std::move(scanners);
+    return ret;
+}
+
+int32_t LexerDfa::state_for(std::vector<int32_t> components)
+{
+    /*
+     * Once a scanner has accepted, the scanners after it can't win anymore.
+     * Forgetting their state keeps the number of combined states down.
+     */
+    State state;
+    auto undetermined { false };
+    state.winner = NoMatch;
+    for (auto ix = 0u; ix < components.size(); ++ix) {
+        if (components[ix] >= 0) {
+            undetermined = true;
+            continue;
+        }
+        if (ScannerAutomaton::is_accept(components[ix])) {
+            state.accepted |= 1ull << ix;
+            if (!undetermined)
+                state.winner = static_cast<int>(ix);
+            for (auto after = ix + 1; after < components.size(); ++after)
+                components[after] = ScannerAutomaton::Reject;
+            break;
+        }
+    }
+    if (undetermined)
+        state.winner = Undetermined;
+
+    if (auto it = m_state_ids.find(components); it != m_state_ids.end())
+        return it->second;
+    auto id = static_cast<int32_t>(m_states.size());
+    state.components = components;
+    m_states.push_back(std::move(state));
+    m_state_ids[components] = id;
+    m_transitions.resize(m_transitions.size() + 256, NotBuilt);
+    return id;
+}
+
+int32_t LexerDfa::build_transition(int32_t state, unsigned char byte)
+{
+    auto components = m_states[state].components;
+    for (auto ix = 0u; ix < components.size(); ++ix) {
+        if (components[ix] >= 0)
+            components[ix] = m_automata[ix].next(components[ix], byte);
+    }
+    auto next = state_for(std::move(components));
+    m_transitions[state * 256 + byte] = next;
+    return next;
+}
+
+std::optional<LexerDfa::Match> LexerDfa::match(std::string_view const& text, size_t pos, bool at_top, size_t* scanned)
+{
+    auto state = (at_top) ? m_start_at_top : m_start;
+    auto p = pos;
+    for (; m_states[state].winner == Undetermined; ++p) {
+        auto byte = (p < text.length()) ? static_cast<unsigned char>(text[p]) : 0;
+        auto next = m_transitions[state * 256 + byte];
+        if (next == NotBuilt)
+            next = build_transition(state, byte);
+        if (auto accepted = m_states[next].accepted & ~m_states[state].accepted; accepted != 0) {
+            for (auto ix = 0u; accepted != 0; ++ix, accepted >>= 1) {
+                if (accepted & 1)
+                    m_lengths[ix] = p - pos;
+            }
+        }
+        state = next;
+    }
+    if (scanned != nullptr)
+        *scanned = p - pos;
+    auto const& winner = m_states[state];
+    if (winner.winner == NoMatch)
+        return {};
+    auto scanner = static_cast<size_t>(winner.winner);
+    auto const& action = m_automata[scanner].action(winner.components[scanner]);
+    return Match { scanner, m_lengths[scanner] - action.back_off, action };
+}
+
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include <lexer/Automaton.h>
+
+namespace Obelix {
+
+class Scanner;
+
+/**
+ * Runs the automata of a list of scanners over the input in lockstep, reading
+ * every byte once. The winning scanner is the first one in priority order
+ * that accepts, which is the scanner Tokenizer::match_token() would have
+ * picked.
+ *
+ * The combined transition table is built lazily, one state at a time, as the
+ * input needs it. A LexerDfa should therefore not be shared between threads.
+ */
+class LexerDfa {
+public:
+    struct Match {
+        size_t scanner;
+        size_t length;
+        ScannerAutomaton::Action const& action;
+    };
+
+    static std::shared_ptr<LexerDfa> compile(std::vector<std::shared_ptr<Scanner>> const&);
+
+    /**
+     * Matches the token at position pos of text, which is at the top of the
+     * input if at_top is set. If scanned is given, it is set to the number
+     * of bytes read, which is more than the length of the match if the DFA
+     * had to look further to decide. A byte past the end of text reads as a
+     * NUL, so if the text is the start of a longer input, the match is only
+     * final if the DFA read less than all of it.
+     */
+    [[nodiscard]] std::optional<Match> match(std::string_view const& text, size_t pos, bool at_top, size_t* scanned = nullptr);
+
+    /**
+     * A copy of this LexerDfa, including the part of the transition table
+     * built so far, handing its matches to the given scanners. These must be
+     * copies of the scanners this LexerDfa was compiled from, in the same
+     * order.
+     */
+    [[nodiscard]] std::shared_ptr<LexerDfa> clone(std::vector<std::shared_ptr<Scanner>>) const;
+    [[nodiscard]] std::vector<std::shared_ptr<Scanner>> const& scanners() const { return m_scanners; }
+    [[nodiscard]] size_t states() const { return m_states.size(); }
+
+private:
+    static constexpr int Undetermined = -1;
+    static constexpr int NoMatch = -2;
+    static constexpr int32_t NotBuilt = -1;
+
+    struct State {
+        std::vector<int32_t> components;
+        int winner { Undetermined };
+        uint64_t accepted { 0 };
+    };
+
+    LexerDfa(std::vector<std::shared_ptr<Scanner>>, std::vector<ScannerAutomaton>);
+    int32_t state_for(std::vector<int32_t>);
+    int32_t build_transition(int32_t, unsigned char);
+
+    std::vector<std::shared_ptr<Scanner>> m_scanners;
+    std::vector<ScannerAutomaton> m_automata;
+    std::vector<State> m_states {};
+    std::map<std::vector<int32_t>, int32_t> m_state_ids {};
+    std::vector<int32_t> m_transitions {};
+    std::vector<size_t> m_lengths {};
+    int32_t m_start { 0 };
+    int32_t m_start_at_top { 0 };
+};
+
+}
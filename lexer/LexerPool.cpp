@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <lexer/LexerPool.h>
+
+namespace Obelix {
+
+LexerPool::Handle::~Handle()
+{
+    if (m_lexer != nullptr)
+        m_pool->release(std::move(m_lexer));
+}
+
+LexerPool::LexerPool(std::shared_ptr<LexerSpec const> spec)
+    : m_spec(std::move(spec))
+{
+}
+
+LexerPool::~LexerPool()
+{
+    oassert(m_acquired == 0, "LexerPool destroyed while {} of its Handles are alive", m_acquired);
+}
+
+LexerPool::Handle LexerPool::acquire()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        ++m_acquired;
+        if (!m_idle.empty()) {
+            auto lexer = std::move(m_idle.back());
+            m_idle.pop_back();
+            return { *this, std::move(lexer) };
+        }
+    }
+    return { *this, std::make_unique<Lexer>(m_spec) };
+}
+
+void LexerPool::release(std::unique_ptr<Lexer> lexer)
+{
+    std::lock_guard lock(m_mutex);
+    --m_acquired;
+    m_idle.push_back(std::move(lexer));
+}
+
+size_t LexerPool::idle() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_idle.size();
+}
+
+size_t LexerPool::acquired() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_acquired;
+}
+
+}
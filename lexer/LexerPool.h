@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <lexer/Lexer.h>
+
+namespace Obelix {
+
+/**
+ * A pool of Lexers created from one LexerSpec, for programs lexing many
+ * small texts. A Lexer returned to the pool keeps its tokenizer, token
+ * vector, arena and bookmark stack, so once the pool is warm lexing a text
+ * doesn't allocate.
+ *
+ * acquire() and the release of a Handle can be called from any thread. The
+ * tokens of a Lexer are only valid until its Handle is destroyed, and a
+ * pooled Lexer must not be reconfigured. A Handle returns its Lexer to the
+ * pool that handed it out, so the pool must outlive all its Handles; this
+ * is asserted when the pool is destroyed.
+ */
+class LexerPool {
+public:
+    class Handle {
+    public:
+        Handle(Handle&&) noexcept = default;
+        Handle(Handle const&) = delete;
+        ~Handle();
+
+        Lexer& operator*() const { return *m_lexer; }
+        Lexer* operator->() const { return m_lexer.get(); }
+
+    private:
+        friend LexerPool;
+        Handle(LexerPool& pool, std::unique_ptr<Lexer> lexer)
+            : m_pool(&pool)
+            , m_lexer(std::move(lexer))
+        {
+        }
+
+        LexerPool* m_pool;
+        std::unique_ptr<Lexer> m_lexer;
+    };
+
+    explicit LexerPool(std::shared_ptr<LexerSpec const>);
+    LexerPool(LexerPool const&) = delete;
+    ~LexerPool();
+
+    [[nodiscard]] Handle acquire();
+    [[nodiscard]] size_t idle() const;
+    [[nodiscard]] size_t acquired() const;
+
+private:
+    void release(std::unique_ptr<Lexer>);
+
+    std::shared_ptr<LexerSpec const> m_spec;
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<Lexer>> m_idle {};
+    size_t m_acquired { 0 }; // Handles that weren't released yet
+};
+
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+
+#include <lexer/LexerDfa.h>
+#include <lexer/LexerSpec.h>
+
+namespace Obelix {
+
+extern_logging_category(lexer);
+
+static std::shared_ptr<Scanner> instantiate(std::shared_ptr<Scanner> const& scanner)
+{
+    auto ret = scanner->clone();
+    return (ret != nullptr) ? ret : scanner;
+}
+
+LexerSpec::LexerSpec(std::set<std::shared_ptr<Scanner>> const& scanners, std::unordered_set<TokenCode> filtered_codes, LexerEngine engine)
+    : m_filtered_codes(std::move(filtered_codes))
+    , m_engine(engine)
+{
+    for (auto const& scanner : scanners) {
+        m_scanners.push_back(instantiate(scanner));
+        m_scanners.back()->freeze();
+    }
+    std::sort(m_scanners.begin(), m_scanners.end(),
+        [](auto const& a, auto const& b) { return *a < *b; });
+    if (m_engine == LexerEngine::Dfa)
+        m_dfa = LexerDfa::compile(m_scanners);
+}
+
+std::vector<std::shared_ptr<Scanner>> LexerSpec::instantiate_scanners() const
+{
+    std::vector<std::shared_ptr<Scanner>> ret;
+    ret.reserve(m_scanners.size());
+    for (auto const& scanner : m_scanners)
+        ret.push_back(instantiate(scanner));
+    return ret;
+}
+
+std::shared_ptr<LexerDfa> LexerSpec::instantiate_dfa(std::vector<std::shared_ptr<Scanner>> const& scanners) const
+{
+    if (m_dfa == nullptr)
+        return nullptr;
+    return m_dfa->clone(scanners);
+}
+
+}
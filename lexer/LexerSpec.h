@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <memory>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include <lexer/Tokenizer.h>
+
+namespace Obelix {
+
+/**
+ * Scanners: try the scanners one by one for every token.
+ * Dfa: run all scanners at once through a LexerDfa compiled from them. Falls
+ * back to Scanners if any of the scanners, for example a CustomScanner,
+ * doesn't provide an automaton.
+ */
+enum class LexerEngine {
+    Scanners,
+    Dfa,
+};
+
+/**
+ * The frozen configuration of a Lexer: its scanners, filtered token codes
+ * and engine. A LexerSpec is built once, from a configured Lexer with
+ * Lexer::spec() or directly, and is never changed after that, so it can be
+ * shared between threads. Lexers created from it get their own copies of
+ * the scanners, which hold the matching state, and of the compiled DFA.
+ *
+ * Custom scanners can't be copied and are shared by all these Lexers, so
+ * their match functions must be safe to call from several threads.
+ */
+class LexerSpec {
+public:
+    LexerSpec(std::set<std::shared_ptr<Scanner>> const&, std::unordered_set<TokenCode>, LexerEngine);
+
+    [[nodiscard]] std::unordered_set<TokenCode> const& filtered_codes() const { return m_filtered_codes; }
+    [[nodiscard]] LexerEngine engine() const { return m_engine; }
+
+    /**
+     * Fresh copies of the scanners, in priority order.
+     */
+    [[nodiscard]] std::vector<std::shared_ptr<Scanner>> instantiate_scanners() const;
+
+    /**
+     * A LexerDfa for scanners returned by instantiate_scanners(), or
+     * nullptr if the engine isn't Dfa or the scanners can't be compiled.
+     */
+    [[nodiscard]] std::shared_ptr<LexerDfa> instantiate_dfa(std::vector<std::shared_ptr<Scanner>> const&) const;
+
+private:
+    std::vector<std::shared_ptr<Scanner>> m_scanners {};
+    std::unordered_set<TokenCode> m_filtered_codes {};
+    LexerEngine m_engine { LexerEngine::Scanners };
+
+    // Compiled once, and only ever copied.
+    std::shared_ptr<LexerDfa> m_dfa {};
+};
+
+}
@@ -4,6 +4,11 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+
 #include <lexer/Token.h>
 #include <lexer/Tokenizer.h>
 
@@ -20,158 +25,240 @@ NumberScanner::NumberScanner(Config const& config)
 {
 }
 
-TokenCode NumberScanner::process(Tokenizer& tokenizer, int ch)
+CharacterSet NumberScanner::start_characters() const
 {
-    TokenCode code = TokenCode::Unknown;
+    CharacterSet ret;
+    for (auto ch = '0'; ch <= '9'; ++ch)
+        ret.set(ch);
+    if (m_config.sign) {
+        ret.set('+');
+        ret.set('-');
+    }
+    if (m_config.fractions)
+        ret.set('.');
+    if (m_config.dollar_hex)
+        ret.set('$');
+    return ret;
+}
 
-    switch (m_state) {
+NumberScanner::Transition NumberScanner::transition(NumberScannerState state, int ch) const
+{
+    switch (state) {
     case NumberScannerState::None:
-        if (m_config.sign && ((ch == '-') || (ch == '+'))) {
-            m_state = NumberScannerState::PlusMinus;
-        } else if (ch == '0') {
-            m_state = NumberScannerState::Zero;
-        } else if (isdigit(ch)) {
-            m_state = NumberScannerState::Number;
-        } else if (m_config.fractions && (ch == '.')) {
-            m_state = NumberScannerState::LeadingPeriod;
-        } else if (m_config.dollar_hex && (ch == '$')) {
-            m_state = NumberScannerState::HexIntegerStart;
-        } else {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Unknown;
-        }
-        break;
+        if (m_config.sign && ((ch == '-') || (ch == '+')))
+            return { NumberScannerState::PlusMinus };
+        if (ch == '0')
+            return { NumberScannerState::Zero };
+        if (isdigit(ch))
+            return { NumberScannerState::Number };
+        if (m_config.fractions && (ch == '.'))
+            return { NumberScannerState::LeadingPeriod };
+        if (m_config.dollar_hex && (ch == '$'))
+            return { NumberScannerState::HexIntegerStart };
+        return { NumberScannerState::Done, TokenCode::Unknown };
 
     case NumberScannerState::PlusMinus:
-        if (ch == '0') {
-            m_state = NumberScannerState::Zero;
-        } else if (m_config.fractions && (ch == '.')) {
-            m_state = NumberScannerState::Period;
-        } else if (isdigit(ch)) {
-            m_state = NumberScannerState::Number;
-        } else {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Unknown;
-        }
-        break;
+        if (ch == '0')
+            return { NumberScannerState::Zero };
+        if (m_config.fractions && (ch == '.'))
+            return { NumberScannerState::Period };
+        if (isdigit(ch))
+            return { NumberScannerState::Number };
+        return { NumberScannerState::Done, TokenCode::Unknown };
 
     case NumberScannerState::LeadingPeriod:
-        if (isdigit(ch)) {
-            m_state = NumberScannerState::Float;
-        } else {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Unknown;
-        }
-        break;
+        if (isdigit(ch))
+            return { NumberScannerState::Float };
+        return { NumberScannerState::Done, TokenCode::Unknown };
 
     case NumberScannerState::Period:
-        if (isdigit(ch)) {
-            m_state = NumberScannerState::Float;
-        } else if (m_config.scientific && (ch == 'e') && (tokenizer.current_token().length() > 1)) {
-            m_state = NumberScannerState::SciFloat;
-        } else {
-            tokenizer.partial_rewind(1);
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Integer;
-        }
-        break;
+        if (isdigit(ch))
+            return { NumberScannerState::Float };
+        /*
+         * Period is only ever reached after at least one character followed
+         * by a '.', so there is always a mantissa in front of the 'e'.
+         */
+        if (m_config.scientific && (ch == 'e'))
+            return { NumberScannerState::SciFloat };
+        return { NumberScannerState::Done, TokenCode::Integer, false, true };
 
     case NumberScannerState::Zero:
-        if (ch == '0') {
-            /*
-             * Chop the previous zero and keep the state. This zero will be chopped
-             * next time around.
-             */
-            tokenizer.chop();
-        } else if (isdigit(ch)) {
-            /*
-             * We don't want octal numbers. Therefore we strip
-             * leading zeroes.
-             */
-            tokenizer.chop();
-            m_state = NumberScannerState::Number;
-        } else if (m_config.fractions && (ch == '.')) {
-            m_state = NumberScannerState::Period;
-        } else if (m_config.hex && (ch == 'x')) {
-            /*
-             * Hexadecimals are returned including the leading
-             * 0x. This allows us to send both base-10 and hex ints
-             * to strtol and friends.
-             */
-            m_state = NumberScannerState::HexIntegerStart;
-        } else {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Integer;
-        }
-        break;
+        /*
+         * Chop the previous zero and keep the state. This zero will be chopped
+         * next time around.
+         */
+        if (ch == '0')
+            return { NumberScannerState::Zero, TokenCode::Unknown, true };
+        /*
+         * We don't want octal numbers. Therefore we strip
+         * leading zeroes.
+         */
+        if (isdigit(ch))
+            return { NumberScannerState::Number, TokenCode::Unknown, true };
+        if (m_config.fractions && (ch == '.'))
+            return { NumberScannerState::Period };
+        /*
+         * Hexadecimals are returned including the leading
+         * 0x. This allows us to send both base-10 and hex ints
+         * to strtol and friends.
+         */
+        if (m_config.hex && (ch == 'x'))
+            return { NumberScannerState::HexIntegerStart };
+        return { NumberScannerState::Done, TokenCode::Integer };
 
     case NumberScannerState::Number:
-        if (m_config.fractions && (ch == '.')) {
-            m_state = NumberScannerState::Period;
-        } else if (m_config.scientific && (ch == 'e')) {
-            m_state = NumberScannerState::SciFloat;
-        } else if (!isdigit(ch)) {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Integer;
-        }
-        break;
+        if (m_config.fractions && (ch == '.'))
+            return { NumberScannerState::Period };
+        if (m_config.scientific && (ch == 'e'))
+            return { NumberScannerState::SciFloat };
+        if (!isdigit(ch))
+            return { NumberScannerState::Done, TokenCode::Integer };
+        return { NumberScannerState::Number };
 
     case NumberScannerState::Float:
-        if (m_config.scientific &&  (ch == 'e')) {
-            m_state = NumberScannerState::SciFloat;
-        } else if (!isdigit(ch)) {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Float;
-        }
-        break;
+        if (m_config.scientific && (ch == 'e'))
+            return { NumberScannerState::SciFloat };
+        if (!isdigit(ch))
+            return { NumberScannerState::Done, TokenCode::Float };
+        return { NumberScannerState::Float };
 
     case NumberScannerState::SciFloat:
-        if ((ch == '+') || (ch == '-')) {
-            m_state = NumberScannerState::SciFloatExpSign;
-        } else if (isdigit(ch)) {
-            m_state = NumberScannerState::SciFloatExp;
-        } else {
-            m_state = NumberScannerState::Error;
-        }
-        break;
+        if ((ch == '+') || (ch == '-'))
+            return { NumberScannerState::SciFloatExpSign };
+        if (isdigit(ch))
+            return { NumberScannerState::SciFloatExp };
+        return { NumberScannerState::Error };
 
     case NumberScannerState::SciFloatExp:
-        if (!isdigit(ch)) {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::Float;
-        }
-        break;
+        if (!isdigit(ch))
+            return { NumberScannerState::Done, TokenCode::Float };
+        return { NumberScannerState::SciFloatExp };
 
     case NumberScannerState::SciFloatExpSign:
-        if (isdigit(ch)) {
-            m_state = NumberScannerState::SciFloatExp;
-        } else {
-            m_state = NumberScannerState::Error;
-        }
-        break;
+        if (isdigit(ch))
+            return { NumberScannerState::SciFloatExp };
+        return { NumberScannerState::Error };
 
     case NumberScannerState::HexIntegerStart:
-        if (!isxdigit(ch)) {
-            m_state = NumberScannerState::Error;
-        } else {
-            m_state = NumberScannerState::HexInteger;
-        }
-        break;
+        if (!isxdigit(ch))
+            return { NumberScannerState::Error };
+        return { NumberScannerState::HexInteger };
 
     case NumberScannerState::HexInteger:
-        if (!isxdigit(ch)) {
-            m_state = NumberScannerState::Done;
-            code = TokenCode::HexNumber;
-        }
-        break;
+        if (!isxdigit(ch))
+            return { NumberScannerState::Done, TokenCode::HexNumber };
+        return { NumberScannerState::HexInteger };
 
     default:
-        oassert(false, "Unreachable");
+        fatal("Unreachable");
     }
+}
+
+TokenCode NumberScanner::process(Tokenizer& tokenizer, int ch)
+{
+    auto t = transition(m_state, ch);
+    if (t.chop)
+        tokenizer.chop();
+    if (t.rewind)
+        tokenizer.partial_rewind(1);
+    m_state = t.state;
     if ((m_state != NumberScannerState::Done) && (m_state != NumberScannerState::Error)) {
         tokenizer.push();
     }
-    return code;
+    return t.code;
+}
+
+std::optional<ScannerAutomaton> NumberScanner::automaton() const
+{
+    constexpr auto num_states = static_cast<size_t>(NumberScannerState::Error) + 1;
+
+    /*
+     * Every scanner state gets two automaton states: one for tokens that are
+     * a slice of the input, and one for tokens that had leading zeroes
+     * chopped and therefore need to be rebuilt by the scanner.
+     */
+    ScannerAutomaton ret;
+    std::array<std::array<int32_t, num_states>, 2> states {};
+    for (auto& s : states) {
+        for (auto& state : s)
+            state = ret.add_state();
+    }
+    auto error = ret.accept({ TokenCode::Error, false, true });
+
+    for (auto dirty = 0u; dirty < 2; ++dirty) {
+        for (auto state = 0u; state < num_states; ++state) {
+            auto from = static_cast<NumberScannerState>(state);
+            if (from == NumberScannerState::Done || from == NumberScannerState::Error)
+                continue;
+            for (auto ix = 0u; ix < 256; ++ix) {
+                auto t = transition(from, tolower(peek_value(ix)));
+                int32_t target;
+                if (t.state == NumberScannerState::Error) {
+                    target = error;
+                } else if (t.state != NumberScannerState::Done) {
+                    target = states[dirty || t.chop][static_cast<size_t>(t.state)];
+                } else if (t.code == TokenCode::Unknown) {
+                    target = ScannerAutomaton::Reject;
+                } else {
+                    target = ret.accept({ t.code, false, dirty != 0, static_cast<uint8_t>(t.rewind ? 1 : 0) });
+                }
+                ret.transition(states[dirty][state], ix, target);
+            }
+        }
+    }
+    ret.start = ret.start_at_top = states[0][static_cast<size_t>(NumberScannerState::None)];
+    return ret;
+}
+
+std::optional<Token::Number> NumberScanner::decode(TokenCode code, std::string_view text)
+{
+    bool negative = false;
+    if (!text.empty() && (text[0] == '+' || text[0] == '-')) {
+        negative = text[0] == '-';
+        text.remove_prefix(1);
+    }
+    if (code == TokenCode::Float) {
+        double value;
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.length(), value);
+        if (ec == std::errc::result_out_of_range) {
+            /*
+             * from_chars doesn't tell underflow, which just loses precision,
+             * from overflow, which is an error.
+             */
+            value = strtod(std::string(text).c_str(), nullptr);
+            if (std::isinf(value))
+                return {};
+        } else if (ec != std::errc()) {
+            return {};
+        }
+        return (negative) ? -value : value;
+    }
+
+    int radix = 10;
+    if (code == TokenCode::HexNumber) {
+        text.remove_prefix((text[0] == '$') ? 1 : 2);
+        radix = 16;
+    }
+    unsigned long magnitude;
+    auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.length(), magnitude, radix);
+    if (ec != std::errc())
+        return {};
+    auto max = static_cast<unsigned long>(std::numeric_limits<long>::max());
+    if (magnitude > max + ((negative) ? 1 : 0))
+        return {};
+    if (negative)
+        return static_cast<long>(0ul - magnitude);
+    return static_cast<long>(magnitude);
+}
+
+void NumberScanner::accept(Tokenizer& tokenizer, TokenCode code, std::string_view text) const
+{
+    auto number = decode(code, text);
+    if (!number.has_value()) {
+        tokenizer.accept(TokenCode::Error, "Number out of range");
+        return;
+    }
+    tokenizer.accept(code, text, number.value());
 }
 
 void NumberScanner::match(Tokenizer& tokenizer)
@@ -185,9 +272,19 @@ void NumberScanner::match(Tokenizer& tokenizer)
         code = process(tokenizer, ch);
     }
     if (m_state == NumberScannerState::Error) {
-5        tokenizer.accept(TokenCode::Error, "Malformed number");
+        tokenizer.accept(TokenCode::Error, "Malformed number");
     } else if (code != TokenCode::Unknown) {
-        tokenizer.accept(code);
+        /*
+         * The token text may have had leading zeroes chopped, in which case
+         * it lives in the tokenizer and doesn't survive accepting it. Decode
+         * before that happens.
+         */
+        auto number = decode(code, tokenizer.current_token());
+        if (!number.has_value()) {
+            tokenizer.accept(TokenCode::Error, "Number out of range");
+            return;
+        }
+        tokenizer.accept(code, number.value());
     }
 }
 
@@ -25,7 +25,7 @@ PlainTextParser::PlainTextParser()
     : BasicParser()
 {
     lexer().add_scanner("plaintext", [](Tokenizer& tokenizer) {
-        switch (int ch = tokenizer.peek()) {
+        switch (tokenizer.peek()) {
         case '\n':
             tokenizer.push();
             tokenizer.accept(TokenCode::NewLine);
@@ -33,10 +33,7 @@ PlainTextParser::PlainTextParser()
         case 0:
             break;
         default:
-            do {
-                tokenizer.push();
-                ch = tokenizer.peek();
-            } while (ch && ch != '\n');
+            (void) tokenizer.scan_until({ "\n\0", 2 });
             tokenizer.accept(TokenCode::Text);
             break;
         }
@@ -6,6 +6,7 @@
 
 #include <array>
 
+#include <core/ByteScan.h>
 #include <lexer/Tokenizer.h>
 
 namespace Obelix {
@@ -17,53 +18,127 @@ QStringScanner::QStringScanner(std::string quotes, bool verbatim)
 {
 }
 
-void QStringScanner::match(Tokenizer& tokenizer)
+TokenCode QStringScanner::unclosed_code(char quote)
 {
-    int ch;
+    static std::array<std::pair<const char,const TokenCode>,3> unclosed_codes {
+        std::pair<const char,const TokenCode> { '"', TokenCode::UnclosedDoubleQuotedString },
+        { '\'', TokenCode::UnclosedSingleQuotedString },
+        { '`', TokenCode::UnclosedBackQuotedString },
+    };
+    for (auto const& pair : unclosed_codes) {
+        if (pair.first == quote)
+            return pair.second;
+    }
+    return TokenCode::Unknown;
+}
 
-    for (m_state = QStrState::Init; m_state != QStrState::Done; ) {
-        ch = tokenizer.peek();
-        if (!ch) {
-            break;
-        }
+CharacterSet QStringScanner::start_characters() const
+{
+    CharacterSet ret;
+    for (auto q : m_quotes)
+        ret.set(static_cast<unsigned char>(q));
+    return ret;
+}
 
-        switch (m_state) {
-        case QStrState::Init:
-            if (m_quotes.find_first_of((char)ch) != std::string::npos) {
-                if (!m_verbatim)
-                    tokenizer.discard();
-                else
-                    tokenizer.push();
-                m_quote = (char)ch;
-                m_state = QStrState::QString;
-            } else {
-                m_state = QStrState::Done;
-            }
-            break;
+std::optional<ScannerAutomaton> QStringScanner::automaton() const
+{
+    for (auto q : m_quotes) {
+        if (unclosed_code(q) == TokenCode::Unknown)
+            return {};
+    }
 
-        case QStrState::QString:
-            if (ch == m_quote) {
-                if (!m_verbatim)
-                    tokenizer.discard();
-                else
-                    tokenizer.push();
-                tokenizer.accept(TokenCode_by_char(m_quote));
-                m_state = QStrState::Done;
-            } else if (ch == '\\') {
-                if (!m_verbatim) {
-                    tokenizer.discard();
-                    m_state = QStrState::Escape;
-                } else {
-                    tokenizer.push();
-                }
+    ScannerAutomaton ret;
+    auto init = ret.add_state();
+    for (auto q : m_quotes) {
+        auto quote = static_cast<unsigned char>(q);
+        if (ret.next(init, quote) != ScannerAutomaton::Reject)
+            continue;
+
+        /*
+         * Strings with escapes, and unclosed strings, are rebuilt by the
+         * scanner. Other strings are a slice of the input, minus the quotes
+         * if the scanner isn't verbatim.
+         */
+        auto text = ret.add_state();
+        auto escaped_text = ret.add_state();
+        auto escape = ret.add_state();
+        auto closed = ret.add_state();
+        auto escaped_closed = ret.add_state();
+        auto trim = static_cast<uint8_t>((m_verbatim) ? 0 : 1);
+        auto code = TokenCode_by_char(quote);
+        auto accept_closed = ret.accept({ code, false, false, 0, trim, trim });
+        auto accept_escaped = ret.accept({ code, false, true });
+        auto unclosed = ret.accept({ unclosed_code(q), false, true });
+        ret.transition(init, quote, text);
+        for (auto ix = 0u; ix < 256; ++ix) {
+            int ch = peek_value(ix);
+            if (!ch) {
+                ret.transition(text, ix, unclosed);
+                ret.transition(escaped_text, ix, unclosed);
+                ret.transition(escape, ix, unclosed);
+            } else if (ch == q) {
+                ret.transition(text, ix, closed);
+                ret.transition(escaped_text, ix, escaped_closed);
+                ret.transition(escape, ix, escaped_text);
+            } else if (ch == '\\' && !m_verbatim) {
+                ret.transition(text, ix, escape);
+                ret.transition(escaped_text, ix, escape);
+                ret.transition(escape, ix, escaped_text);
             } else {
-                tokenizer.push();
+                ret.transition(text, ix, text);
+                ret.transition(escaped_text, ix, escaped_text);
+                ret.transition(escape, ix, escaped_text);
             }
-            break;
+            ret.transition(closed, ix, accept_closed);
+            ret.transition(escaped_closed, ix, accept_escaped);
+        }
+    }
+    ret.start = ret.start_at_top = init;
+    return ret;
+}
+
+void QStringScanner::match(Tokenizer& tokenizer)
+{
+    int ch = tokenizer.peek();
+    if (!ch || m_quotes.find_first_of((char)ch) == std::string::npos)
+        return;
+    m_quote = (char)ch;
+
+    /*
+     * Jump from one quote, backslash, or NUL to the next. The input ends at
+     * a NUL, like it does for Tokenizer::peek(). As long as there are no
+     * escapes, the token value is a slice of the input.
+     */
+    char const stops[] = { m_quote, '\0', '\\' };
+    auto stops_view = std::string_view(stops, (m_verbatim) ? 2 : 3);
+    auto const& buffer = tokenizer.buffer();
+    auto text = buffer.buffer().substr(buffer.position());
+    auto stop = find_any_of(text.substr(1), stops_view);
+    stop = (stop != std::string_view::npos) ? stop + 1 : text.length();
 
-        case QStrState::Escape:
-            assert(!m_verbatim);
-            switch (ch) {
+    if (stop == text.length() || text[stop] != '\\') {
+        auto closed = (stop < text.length()) && (text[stop] == m_quote);
+        tokenizer.push((closed) ? stop + 1 : stop);
+        auto value = tokenizer.current_token();
+        if (!m_verbatim)
+            value = value.substr(1, value.length() - ((closed) ? 2 : 1));
+        tokenizer.accept((closed) ? TokenCode_by_char(m_quote) : unclosed_code(m_quote), value);
+        return;
+    }
+
+    /*
+     * There are escapes, so the token value has to be built:
+     */
+    tokenizer.discard();
+    tokenizer.push(stop - 1);
+    for (ch = tokenizer.peek(); ch && ch != m_quote; ch = tokenizer.peek()) {
+        // Not a backslash if the text of a windowed buffer ended, and
+        // peek() loaded more:
+        if (ch == '\\') {
+            tokenizer.discard();
+            switch (ch = tokenizer.peek()) {
+            case 0:
+                break;
             case 'r':
                 tokenizer.push_as('\r');
                 break;
@@ -76,27 +151,21 @@ void QStringScanner::match(Tokenizer& tokenizer)
             default:
                 tokenizer.push();
             }
-            m_state = QStrState::QString;
-            break;
-
-        default:
-            fatal("Unreachable");
+            if (!ch)
+                break;
         }
+        text = buffer.buffer().substr(buffer.position());
+        stop = find_any_of(text, stops_view);
+        tokenizer.push((stop != std::string_view::npos) ? stop : text.length());
     }
-    if (!ch && ((m_state == QStrState::QString) || (m_state == QStrState::Escape))) {
-        static std::array<std::pair<const char,const TokenCode>,3> unclosed_codes {
-            std::pair<const char,const TokenCode> { '"', TokenCode::UnclosedDoubleQuotedString },
-            { '\'', TokenCode::UnclosedSingleQuotedString },
-            { '`', TokenCode::UnclosedBackQuotedString },
-        };
-        TokenCode code = TokenCode::Unknown;
-        for (auto const& pair : unclosed_codes) {
-            if (pair.first == m_quote)
-                code = pair.second;
-        }
+    if (!ch) {
+        TokenCode code = unclosed_code(m_quote);
         assert(code != TokenCode::Unknown);
         tokenizer.accept(code);
+        return;
     }
+    tokenizer.discard();
+    tokenizer.accept(TokenCode_by_char(m_quote));
 }
 
 }
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <array>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <core/Logging.h>
+#include <lexer/SourceFiles.h>
+
+namespace Obelix {
+
+namespace {
+
+/*
+ * Names are stored in fixed-size chunks that are allocated once and never
+ * moved, so name() can read them without a lock. The chunk pointers are
+ * published with release stores after the chunk is filled in.
+ */
+constexpr size_t ChunkSize = 1024;
+constexpr size_t MaxChunks = 1024;
+
+using Chunk = std::array<std::string_view, ChunkSize>;
+
+struct Registry {
+    std::mutex mutex;
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, FileId> ids;
+    std::array<std::atomic<Chunk*>, MaxChunks> chunks {};
+    std::atomic<size_t> count { 1 };
+
+    Registry()
+    {
+        // FileId 0 is the file without a name.
+        chunks[0] = new Chunk {};
+        ids[""] = SourceFiles::NoFile;
+    }
+};
+
+Registry& registry()
+{
+    static Registry s_registry;
+    return s_registry;
+}
+
+}
+
+FileId SourceFiles::intern(std::string_view name)
+{
+    if (name.empty())
+        return NoFile;
+    auto& reg = registry();
+    std::lock_guard lock(reg.mutex);
+    if (auto it = reg.ids.find(name); it != reg.ids.end())
+        return it->second;
+
+    auto id = reg.count.load(std::memory_order_relaxed);
+    if (id >= ChunkSize * MaxChunks)
+        fatal("Too many source files");
+    auto const& stored = reg.names.emplace_back(name);
+    auto chunk = reg.chunks[id / ChunkSize].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        chunk = new Chunk {};
+        reg.chunks[id / ChunkSize].store(chunk, std::memory_order_release);
+    }
+    (*chunk)[id % ChunkSize] = stored;
+    reg.ids[stored] = static_cast<FileId>(id);
+    reg.count.store(id + 1, std::memory_order_release);
+    return static_cast<FileId>(id);
+}
+
+std::string_view SourceFiles::name(FileId id)
+{
+    auto& reg = registry();
+    if (id >= reg.count.load(std::memory_order_acquire))
+        return {};
+    return (*reg.chunks[id / ChunkSize].load(std::memory_order_acquire))[id % ChunkSize];
+}
+
+size_t SourceFiles::count()
+{
+    return registry().count.load(std::memory_order_acquire);
+}
+
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace Obelix {
+
+using FileId = uint32_t;
+
+/**
+ * Process-wide registry of the names of source files. A Lexer interns the
+ * name of its file once when it gets a new buffer, and Spans carry the
+ * compact FileId instead of the name.
+ *
+ * intern() takes a lock. name() doesn't: names are never removed or moved,
+ * so a FileId, once handed out, can be looked up from any thread.
+ */
+class SourceFiles {
+public:
+    /**
+     * The ID of the file without a name.
+     */
+    static constexpr FileId NoFile = 0;
+
+    [[nodiscard]] static FileId intern(std::string_view name);
+    [[nodiscard]] static std::string_view name(FileId id);
+    [[nodiscard]] static size_t count();
+};
+
+}
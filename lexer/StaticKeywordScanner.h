@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+#include <lexer/Tokenizer.h>
+
+namespace Obelix {
+
+/**
+ * The text KeywordScanner::add_keyword() uses for a keyword added without
+ * one, i.e. TokenCode_name() for the built-in token codes.
+ */
+constexpr char const* StaticKeyword_default_text(TokenCode code)
+{
+    switch (code) {
+#undef ENUM_TOKEN_CODE
+#define ENUM_TOKEN_CODE(code, c, str) \
+    case TokenCode::code:             \
+        return (str != nullptr) ? str : #code;
+        ENUMERATE_TOKEN_CODES(ENUM_TOKEN_CODE)
+#undef ENUM_TOKEN_CODE
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * A keyword known at compile time, used as a template argument of
+ * StaticKeywordScanner.
+ */
+struct StaticKeyword {
+    static constexpr size_t MaxLength = 31;
+
+    constexpr StaticKeyword(TokenCode keyword_code)
+        : StaticKeyword(keyword_code, StaticKeyword_default_text(keyword_code))
+    {
+    }
+
+    constexpr StaticKeyword(int keyword_code, char const* keyword_text)
+        : StaticKeyword(static_cast<TokenCode>(keyword_code), keyword_text)
+    {
+    }
+
+    constexpr StaticKeyword(TokenCode keyword_code, char const* keyword_text)
+        : code(keyword_code)
+    {
+        if (keyword_text == nullptr)
+            return;
+        for (; keyword_text[length] != '\0' && length < MaxLength; ++length)
+            text[length] = keyword_text[length];
+        valid = length > 0 && keyword_text[length] == '\0';
+    }
+
+    [[nodiscard]] constexpr std::string_view token() const { return { text, length }; }
+
+    [[nodiscard]] constexpr bool is_operator() const
+    {
+        auto ch = text[length - 1];
+        return !(ch >= 'a' && ch <= 'z') && !(ch >= 'A' && ch <= 'Z') && !(ch >= '0' && ch <= '9') && (ch != '_');
+    }
+
+    TokenCode code;
+    char text[MaxLength + 1] {};
+    size_t length { 0 };
+    bool valid { false };
+};
+
+/**
+ * A KeywordScanner with its keyword list fixed at compile time:
+ *
+ *     lexer.add_scanner<StaticKeywordScanner<
+ *         StaticKeyword { TokenCode::Keyword0, "for" },
+ *         StaticKeyword { TokenCode::Keyword1, "format" },
+ *         TokenCode::GreaterEqualThan>>();
+ *
+ * The keyword trie is built by the compiler, so there is no construction
+ * cost at startup. It emits the same token codes as a KeywordScanner with
+ * the same keywords, and follows the same matching rules.
+ */
+template<bool CaseSensitive, StaticKeyword... Keywords>
+class BasicStaticKeywordScanner : public Scanner {
+public:
+    static_assert(sizeof...(Keywords) > 0, "A StaticKeywordScanner needs at least one keyword");
+    static_assert((Keywords.valid && ...), "Static keywords need a text of at most StaticKeyword::MaxLength characters");
+
+    BasicStaticKeywordScanner()
+        : Scanner()
+    {
+    }
+
+    [[nodiscard]] char const* name() const override { return "keyword"; }
+    [[nodiscard]] std::shared_ptr<Scanner> clone() const override { return std::make_shared<BasicStaticKeywordScanner>(*this); }
+
+    [[nodiscard]] CharacterSet start_characters() const override
+    {
+        CharacterSet ret;
+        for (auto ix = 0u; ix < s_trie.nodes[0].edges; ++ix) {
+            auto ch = s_trie.edge_bytes[ix];
+            ret.set(ch);
+            if (!CaseSensitive)
+                ret.set(static_cast<unsigned char>(tolower(ch)));
+        }
+        return ret;
+    }
+
+    [[nodiscard]] std::optional<ScannerAutomaton> automaton() const override
+    {
+        KeywordScanner scanner(CaseSensitive);
+        (scanner.add_keyword(Keywords.code, std::string(Keywords.token())), ...);
+        return scanner.automaton();
+    }
+
+    void match(Tokenizer& tokenizer) override
+    {
+        /*
+         * The same rules as KeywordScanner::match(): the longest keyword
+         * wins, an alphanumeric keyword directly followed by an alphanumeric
+         * character doesn't match, and at the end of the input the keyword
+         * must not be the prefix of another keyword.
+         */
+        uint32_t node = 0;
+        for (int ch = tokenizer.peek(); true; ch = tokenizer.peek()) {
+            auto next = (ch) ? child(node, fold(ch)) : -1;
+            if (next < 0) {
+                auto const& n = s_trie.nodes[node];
+                if (n.keyword < 0)
+                    return;
+                auto const& keyword = s_keywords[n.keyword];
+                if (!ch) {
+                    if (n.count == 1)
+                        tokenizer.accept(keyword.code);
+                } else if (keyword.is_operator() || (!isalnum(ch) && (ch != '_'))) {
+                    tokenizer.accept(keyword.code);
+                }
+                return;
+            }
+            node = static_cast<uint32_t>(next);
+            tokenizer.push();
+        }
+    }
+
+private:
+    struct Node {
+        uint32_t first_edge { 0 };
+        uint32_t edges { 0 };
+        uint32_t count { 0 };
+        int keyword { -1 };
+    };
+
+    static constexpr size_t KeywordCount = sizeof...(Keywords);
+
+    static constexpr char fold_upper(char ch)
+    {
+        return (!CaseSensitive && ch >= 'a' && ch <= 'z') ? static_cast<char>(ch - 'a' + 'A') : ch;
+    }
+
+    static int fold(int ch)
+    {
+        return (CaseSensitive) ? ch : toupper(ch);
+    }
+
+    static constexpr StaticKeyword folded(StaticKeyword keyword)
+    {
+        for (auto ix = 0u; ix < keyword.length; ++ix)
+            keyword.text[ix] = fold_upper(keyword.text[ix]);
+        return keyword;
+    }
+
+    static constexpr std::array<StaticKeyword, KeywordCount> s_keywords { folded(Keywords)... };
+
+    /*
+     * Keyword indexes sorted by text, later duplicates after earlier ones,
+     * which is the order KeywordScanner::build_trie() uses.
+     */
+    static constexpr std::array<uint32_t, KeywordCount> sorted_keywords()
+    {
+        std::array<uint32_t, KeywordCount> ret {};
+        for (auto ix = 0u; ix < KeywordCount; ++ix) {
+            auto pos = ix;
+            for (; pos > 0 && s_keywords[ix].token() < s_keywords[ret[pos - 1]].token(); --pos)
+                ret[pos] = ret[pos - 1];
+            ret[pos] = ix;
+        }
+        return ret;
+    }
+
+    static constexpr std::array<uint32_t, KeywordCount> s_order = sorted_keywords();
+
+    static constexpr size_t node_count()
+    {
+        size_t ret = 1;
+        for (auto ix = 0u; ix < KeywordCount; ++ix) {
+            auto token = s_keywords[s_order[ix]].token();
+            size_t common = 0;
+            if (ix > 0) {
+                auto previous = s_keywords[s_order[ix - 1]].token();
+                while (common < token.length() && common < previous.length() && token[common] == previous[common])
+                    ++common;
+            }
+            ret += token.length() - common;
+        }
+        return ret;
+    }
+
+    static constexpr size_t NodeCount = node_count();
+
+    struct Trie {
+        std::array<Node, NodeCount> nodes {};
+        std::array<unsigned char, NodeCount - 1> edge_bytes {};
+        std::array<uint32_t, NodeCount - 1> edge_targets {};
+        uint32_t node_count { 0 };
+        uint32_t edge_count { 0 };
+
+        constexpr uint32_t build(size_t lo, size_t hi, size_t depth)
+        {
+            auto id = node_count++;
+            nodes[id].count = static_cast<uint32_t>(hi - lo);
+            for (; lo < hi && s_keywords[s_order[lo]].length == depth; ++lo)
+                nodes[id].keyword = static_cast<int>(s_order[lo]);
+
+            auto first_edge = edge_count;
+            nodes[id].first_edge = first_edge;
+            for (auto ix = lo; ix < hi; ++ix) {
+                if (ix == lo || s_keywords[s_order[ix]].text[depth] != s_keywords[s_order[ix - 1]].text[depth])
+                    edge_bytes[edge_count++] = static_cast<unsigned char>(s_keywords[s_order[ix]].text[depth]);
+            }
+            nodes[id].edges = edge_count - first_edge;
+            auto child_lo = lo;
+            for (auto edge = first_edge; edge < first_edge + nodes[id].edges; ++edge) {
+                auto child_hi = child_lo;
+                while (child_hi < hi && static_cast<unsigned char>(s_keywords[s_order[child_hi]].text[depth]) == edge_bytes[edge])
+                    ++child_hi;
+                edge_targets[edge] = build(child_lo, child_hi, depth + 1);
+                child_lo = child_hi;
+            }
+            return id;
+        }
+    };
+
+    static constexpr Trie build_trie()
+    {
+        Trie ret;
+        ret.build(0, KeywordCount, 0);
+        return ret;
+    }
+
+    static constexpr Trie s_trie = build_trie();
+
+    static int child(uint32_t node, int ch)
+    {
+        auto const& n = s_trie.nodes[node];
+        auto begin = s_trie.edge_bytes.begin() + n.first_edge;
+        auto end = begin + n.edges;
+        auto it = std::lower_bound(begin, end, static_cast<unsigned char>(ch));
+        if (it == end || *it != static_cast<unsigned char>(ch))
+            return -1;
+        return static_cast<int>(s_trie.edge_targets[it - s_trie.edge_bytes.begin()]);
+    }
+};
+
+template<StaticKeyword... Keywords>
+using StaticKeywordScanner = BasicStaticKeywordScanner<true, Keywords...>;
+
+template<StaticKeyword... Keywords>
+using CaseInsensitiveStaticKeywordScanner = BasicStaticKeywordScanner<false, Keywords...>;
+
+}
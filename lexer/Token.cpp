@@ -26,12 +26,12 @@ std::string TokenCode_name(TokenCode t)
 
 bool Location::operator==(Location const& other) const
 {
-    return index == other.index;
+    return line == other.line && column == other.column;
 }
 
 bool Location::operator<(Location const& other) const
 {
-    return index < other.index;
+    return line < other.line || (line == other.line && column < other.column);
 }
 
 std::string Location::to_string() const
@@ -39,68 +39,43 @@ std::string Location::to_string() const
     return format("{}:{}", line, column);
 }
 
-std::set<std::string> Span::s_files;
-
-Span::Span(std::string_view fname, Location loc_1, Location loc_2)
-    : file_name(fname)
-    , start(loc_1)
-    , end(loc_2)
+Span::Span(FileId file, LineIndex const* line_index, size_t start_index, size_t end_index)
+    : file_id(file)
+    , start({ start_index, 0, 0 })
+    , end({ end_index, 0, 0 })
+    , lines(line_index)
 {
+    if (lines == nullptr)
+        return;
+    std::tie(start.line, start.column) = lines->line_column(start_index);
+    std::tie(end.line, end.column) = lines->line_column(end_index);
 }
 
-Span::Span(std::string_view fname, size_t line_1, size_t col_1, size_t line_2, size_t col_2)
-    : file_name(fname)
-    , start({ line_1, col_1 })
-    , end({ line_2, col_2 })
-{
-}
-
-Span::Span(char const* fname, Location loc_1, Location loc_2)
-    : file_name(fname)
+Span::Span(FileId file, Location loc_1, Location loc_2)
+    : file_id(file)
     , start(loc_1)
     , end(loc_2)
 {
 }
 
-Span::Span(char const* fname, size_t line_1, size_t col_1, size_t line_2, size_t col_2)
-    : file_name(fname)
-    , start({ line_1, col_1 })
-    , end({ line_2, col_2 })
-{
-}
-
-Span::Span(std::string const& fname, Location loc_1, Location loc_2)
-    : start(loc_1)
-    , end(loc_2)
+Span::Span(std::string_view fname, Location loc_1, Location loc_2)
+    : Span(SourceFiles::intern(fname), loc_1, loc_2)
 {
-    if (!s_files.contains(fname)) {
-        s_files.emplace(fname);
-    }
-    auto it = s_files.find(fname);
-    assert(it != s_files.end());
-    file_name = *it;
 }
 
-Span::Span(std::string const& fname, size_t line_1, size_t col_1, size_t line_2, size_t col_2)
-    : start({ line_1, col_1 })
-    , end({ line_2, col_2 })
+Span::Span(std::string_view fname, size_t line_1, size_t col_1, size_t line_2, size_t col_2)
+    : Span(SourceFiles::intern(fname), Location { 0, line_1, col_1 }, Location { 0, line_2, col_2 })
 {
-    if (!s_files.contains(fname)) {
-        s_files.emplace(fname);
-    }
-    auto it = s_files.find(fname);
-    assert(it != s_files.end());
-    file_name = *it;
 }
 
 std::string Span::to_string() const
 {
     if (!empty()) {
-        return (!file_name.empty())
-            ? format("{}:{}-{}", file_name, start, end)
+        return (file_id != SourceFiles::NoFile)
+            ? format("{}:{}-{}", file_name(), start, end)
             : format("{}-{}", start, end);
     } else {
-        return format("{}:", file_name);
+        return format("{}:", file_name());
     }
 }
 
@@ -111,7 +86,7 @@ std::string Span::to_string() const
 
 bool Span::operator==(Span const& other) const
 {
-    return file_name == other.file_name && start == other.start && end == other.end;
+    return file_id == other.file_id && start == other.start && end == other.end;
 }
 
 Span Span::merge(Span const& other) const
@@ -128,7 +103,39 @@ Span Span::merge(Span const& other) const
     size_t new_end_column = end.column;
     if (other.end.column > new_end_column)
         new_end_column = other.end.column;
-    return Span { file_name, new_start_line, new_start_column, new_end_line, new_end_column };
+    Span ret { file_id, Location { 0, new_start_line, new_start_column }, Location { 0, new_end_line, new_end_column } };
+    ret.start.index = std::min(start.index, other.start.index);
+    ret.end.index = std::max(end.index, other.end.index);
+    ret.lines = (lines == other.lines) ? lines : nullptr;
+    return ret;
+}
+
+Span Token::location() const
+{
+    if (m_lines != nullptr)
+        return { m_file_id, m_lines, m_start, m_end };
+    return { m_file_id, Location { m_start, m_start_line, m_start_column }, Location { m_end, m_end_line, m_end_column } };
+}
+
+void Token::location(Span const& location)
+{
+    m_start = location.start.index;
+    m_end = location.end.index;
+    m_file_id = location.file_id;
+    m_lines = location.lines;
+    m_start_line = static_cast<uint32_t>(location.start.line);
+    m_start_column = static_cast<uint32_t>(location.start.column);
+    m_end_line = static_cast<uint32_t>(location.end.line);
+    m_end_column = static_cast<uint32_t>(location.end.column);
+}
+
+void Token::resolve()
+{
+    if (m_lines == nullptr)
+        return;
+    auto span = location();
+    span.lines = nullptr;
+    location(span);
 }
 
 std::string Token::to_string() const
@@ -142,11 +149,17 @@ std::string Token::to_string() const
 
 std::optional<long> Token::to_long() const
 {
+    if (std::holds_alternative<long>(m_number))
+        return std::get<long>(m_number);
     return Obelix::to_long(m_value);
 }
 
 std::optional<double> Token::to_double() const
 {
+    if (std::holds_alternative<double>(m_number))
+        return std::get<double>(m_number);
+    if (std::holds_alternative<long>(m_number))
+        return static_cast<double>(std::get<long>(m_number));
     return Obelix::to_double(m_value);
 }
 
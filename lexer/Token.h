@@ -6,15 +6,19 @@
 
 #pragma once
 
+#include <cstdint>
 #include <cstring>
 #include <optional>
 #include <set>
 #include <string>
+#include <variant>
 
 #include <core/Error.h>
 #include <core/Format.h>
 #include <core/Logging.h>
+#include <core/StringBuffer.h>
 #include <core/StringUtil.h>
+#include <lexer/SourceFiles.h>
 
 namespace Obelix {
 
@@ -276,85 +280,109 @@ struct Location {
 };
 
 struct Span {
-    std::string_view file_name = {};
+    FileId file_id { SourceFiles::NoFile };
     Location start;
     Location end;
+    LineIndex const* lines { nullptr };
 
     Span() = default;
+    Span(FileId, LineIndex const*, size_t, size_t);
+    Span(FileId, Location, Location);
     Span(std::string_view, Location, Location);
     Span(std::string_view, size_t, size_t, size_t, size_t);
-    Span(char const*, Location, Location);
-    Span(char const*, size_t, size_t, size_t, size_t);
-    Span(std::string const&, Location, Location);
-    Span(std::string const&, size_t, size_t, size_t, size_t);
 
+    [[nodiscard]] std::string_view file_name() const { return SourceFiles::name(file_id); }
     [[nodiscard]] std::string to_string() const;
     [[nodiscard]] Span merge(Span const&) const;
     [[nodiscard]] bool empty() const;
 
     Span& operator=(Span const& other) = default;
     bool operator==(Span const& other) const;
-
-private:
-    static std::set<std::string> s_files;
 };
 
+/**
+ * A token of a text. A Token doesn't own its text and is trivially
+ * copyable. Its value points into the lexed buffer or into the Lexer's
+ * StringArena, and a token from a buffer looks up its line and column
+ * numbers in the buffer's line index, so it is only valid as long as the
+ * Lexer that produced it exists and isn't assigned a new text. The tokens
+ * returned by Lexer::lex() are resolved: they carry their own line and
+ * column numbers, so their location() stays valid after that as long as
+ * their value doesn't point into the buffer or the arena.
+ */
 class Token {
 public:
+    /*
+     * The value of a number token, decoded by the scanner while lexing.
+     */
+    using Number = std::variant<std::monostate, long, double>;
+
     Token() = default;
-    Token(Span location, TokenCode code, std::string_view value = {})
-        : m_location(location)
+    Token(Span const& location, TokenCode code, std::string_view value = {})
+        : m_value(value)
         , m_code(code)
-        , m_value(value)
     {
+        this->location(location);
     }
 
-    Token(Span location, int code, std::string_view value = {})
+    Token(Span const& location, int code, std::string_view value = {})
         : Token(location, static_cast<TokenCode>(code), value)
     {
     }
 
-    Token(Span location, TokenCode code, std::string const& value)
-        : m_location(location)
-        , m_code(code)
+    Token(Span const& location, TokenCode code, const char* value)
+        : Token(location, code, std::string_view(value))
     {
-        m_value_string = strdup(value.c_str());
-        m_value = std::string_view(m_value_string.value());
     }
 
-    Token(Span location, TokenCode code, const char* value)
-        : m_location(location)
-        , m_code(code)
+    /*
+     * A Token doesn't own its text, so it can't be built from a std::string,
+     * which would leave it pointing into the string's storage. Text that
+     * isn't a slice of the source is stored in a StringArena that outlives
+     * the token, like the Lexer's.
+     */
+    Token(Span const&, TokenCode, std::string const&) = delete;
+    Token(Span const&, TokenCode, std::string&&) = delete;
+    Token(Span const&, int, std::string const&) = delete;
+    Token(Span const&, int, std::string&&) = delete;
+
+    /*
+     * A token covering the bytes [start, end) of a buffer. Line and column
+     * numbers are only looked up in the buffer's line index when location()
+     * is called.
+     */
+    Token(TokenCode code, std::string_view value, size_t start, size_t end, FileId file_id, LineIndex const* lines)
+        : m_start(start)
+        , m_end(end)
+        , m_lines(lines)
         , m_value(value)
+        , m_code(code)
+        , m_file_id(file_id)
     {
     }
 
-    Token(Token const& other)
-        : m_location(other.m_location)
-        , m_code(other.m_code)
-    {
-        if (other.m_value_string.has_value()) {
-            m_value_string = strdup(other.m_value_string.value());
-            m_value = std::string_view(m_value_string.value());
-        } else {
-            m_value = other.m_value;
-        }
-    }
-
-    virtual ~Token()
-    {
-        if (m_value_string.has_value())
-            free(m_value_string.value());
-    }
-
-    Token& operator=(Token const& other) = default;
-
-    [[nodiscard]] Span const& location() const { return m_location; }
-    void location(Span location) { m_location = location; }
+    /**
+     * The span of the token. If the token refers to a line index, line and
+     * column numbers are looked up in it. Otherwise they are the ones it was
+     * built with, for example from a Span with explicit positions.
+     */
+    [[nodiscard]] Span location() const;
+    void location(Span const& location);
+
+    /**
+     * Looks up the line and column numbers now and stops referring to the
+     * line index, so that location() doesn't depend on the buffer anymore.
+     */
+    void resolve();
+
+    [[nodiscard]] size_t start_index() const { return m_start; }
+    [[nodiscard]] size_t end_index() const { return m_end; }
     [[nodiscard]] TokenCode code() const { return m_code; }
     [[nodiscard]] std::string code_name() const { return TokenCode_name(code()); }
     [[nodiscard]] std::string_view const& value() const { return m_value; }
     [[nodiscard]] std::string string_value() const { return std::string(m_value); }
+    [[nodiscard]] Number const& number() const { return m_number; }
+    void number(Number number) { m_number = number; }
     [[nodiscard]] std::string to_string() const;
     [[nodiscard]] std::optional<long> to_long() const;
     [[nodiscard]] std::optional<double> to_double() const;
@@ -363,12 +391,22 @@ public:
     [[nodiscard]] bool is_whitespace() const;
 
 private:
-    Span m_location;
-    TokenCode m_code { TokenCode::Unknown };
-    std::optional<char*> m_value_string {};
+    size_t m_start { 0 };
+    size_t m_end { 0 };
+    LineIndex const* m_lines { nullptr };
+    // Line and column numbers, only used if m_lines is nullptr.
+    uint32_t m_start_line { 0 };
+    uint32_t m_start_column { 0 };
+    uint32_t m_end_line { 0 };
+    uint32_t m_end_column { 0 };
     std::string_view m_value {};
+    Number m_number {};
+    TokenCode m_code { TokenCode::Unknown };
+    FileId m_file_id { SourceFiles::NoFile };
 };
 
+static_assert(std::is_trivially_copyable_v<Token>);
+
 class SyntaxError {
 public:
     SyntaxError(Span const& location, std::string msg)
@@ -420,7 +458,7 @@ inline ErrorOr<T, SyntaxError> token_value(Token const& token)
 {
     if (token.code() != TokenCode::Float && token.code() != TokenCode::Integer && token.code() != TokenCode::HexNumber)
         return SyntaxError { token.location(), "Cannot get {} value as {}", token.code(), typeid(T).name() };
-    auto v = to_long(token.value());
+    auto v = (std::holds_alternative<long>(token.number())) ? std::get<long>(token.number()) : to_long(token.value());
     if (v < std::numeric_limits<T>::min() || v > std::numeric_limits<T>::max())
         return SyntaxError { token.location(), "Long value {} overflows {}", v, typeid(T).name() };
     return static_cast<T>(v);
@@ -431,8 +469,8 @@ inline ErrorOr<T, SyntaxError> token_value(Token const& token)
 {
     if (token.code() != TokenCode::Float && token.code() != TokenCode::Integer && token.code() != TokenCode::HexNumber)
         return SyntaxError { token.location(), "Cannot get {} value as {}", token.code(), typeid(T).name() };
-    auto v = to_double(token.value());
-    if (v < std::numeric_limits<T>::min() || v > std::numeric_limits<T>::max())
+    auto v = (std::holds_alternative<double>(token.number())) ? std::get<double>(token.number()) : to_double(token.value());
+    if (v < std::numeric_limits<T>::lowest() || v > std::numeric_limits<T>::max())
         return SyntaxError { token.location(), "Float value {} overflows {}", v, typeid(T).name() };
     return static_cast<T>(v);
 }
@@ -4,54 +4,164 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <chrono>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <core/ByteScan.h>
+#include <lexer/LexerDfa.h>
 #include <lexer/Tokenizer.h>
 
 namespace Obelix {
 
 extern_logging_category(lexer);
 
-class CatchAll : public Scanner {
-public:
-    explicit CatchAll()
-        : Scanner(99)
-    {
+ScannerStatistics& TokenizerStatistics::scanner(std::string_view name)
+{
+    for (auto& stats : scanners) {
+        if (stats.scanner == name)
+            return stats;
     }
+    return scanners.emplace_back(ScannerStatistics { std::string(name) });
+}
 
-    void match(Tokenizer& tokenizer) override
-    {
+void TokenizerStatistics::merge(TokenizerStatistics const& other)
+{
+    for (auto const& theirs : other.scanners) {
+        auto& ours = scanner(theirs.scanner);
+        ours.attempts += theirs.attempts;
+        ours.successes += theirs.successes;
+        ours.bytes += theirs.bytes;
+        ours.rewinds += theirs.rewinds;
+        ours.cycles += theirs.cycles;
     }
+    catchall += other.catchall;
+}
 
-    [[nodiscard]] char const* name() const override { return "catchall"; }
+std::string TokenizerStatistics::to_string() const
+{
+    std::string ret;
+    for (auto const& stats : scanners) {
+        ret += format("{}: attempts {} successes {} bytes {} rewinds {} cycles {}\n",
+            stats.scanner, stats.attempts, stats.successes, stats.bytes, stats.rewinds, stats.cycles);
+    }
+    ret += format("catchall: {}", catchall);
+    return ret;
+}
 
-private:
-};
+void Scanner::accept(Tokenizer& tokenizer, TokenCode code, std::string_view value) const
+{
+    tokenizer.accept(code, value);
+}
 
-Tokenizer::Tokenizer(StringBuffer& text, std::string file_name)
+Tokenizer::Tokenizer(StringBuffer& text, FileId file_id)
     : m_buffer(text)
-    , m_file_name(std::move(file_name))
+    , m_lines(&text.lines())
+    , m_file_id(file_id)
+    , m_mark(text.offset())
+{
+}
+
+Tokenizer::Tokenizer(StringBuffer const& buffer, size_t offset, FileId file_id)
+    : m_string_buffer(buffer.buffer())
+    , m_buffer(m_string_buffer.value())
+    , m_lines(&buffer.lines())
+    , m_file_id(file_id)
+{
+    m_buffer.skip(offset);
+    reset();
+}
+
+Tokenizer::Tokenizer(StringBuffer& text, std::string const& file_name)
+    : Tokenizer(text, SourceFiles::intern(file_name))
 {
 }
 
-Tokenizer::Tokenizer(std::string_view const& text, std::string file_name)
+Tokenizer::Tokenizer(std::string_view const& text, std::string const& file_name)
     : m_string_buffer(text)
     , m_buffer(m_string_buffer.value())
-    , m_file_name(std::move(file_name))
+    , m_lines(&m_buffer.lines())
+    , m_file_id(SourceFiles::intern(file_name))
 {
 }
 
 std::vector<Token> const& Tokenizer::tokenize(std::vector<Token>& tokens)
 {
+    tokenize(tokens, std::numeric_limits<size_t>::max());
+    oassert(!tokens.empty(), "tokenize() found no tokens, not even EOF");
+    oassert(tokens.back().code() == TokenCode::EndOfFile, "tokenize() did not leave an EOF");
+    return tokens;
+}
+
+bool Tokenizer::tokenize(std::vector<Token>& tokens, size_t size)
+{
+    prepare();
+    m_tokens = &tokens;
+    while (m_state != TokenizerState::Done && tokens.size() < size) {
+        match_token();
+    }
+    return m_state != TokenizerState::Done;
+}
+
+bool Tokenizer::tokenize_until(std::vector<Token>& tokens, size_t offset, std::vector<SyncPoint>* sync_points)
+{
+    prepare();
+    m_tokens = &tokens;
+    while (m_state != TokenizerState::Done && m_buffer.offset() < offset) {
+        match_token();
+        if (sync_points != nullptr && synchronized())
+            sync_points->push_back({ m_buffer.offset(), tokens.size() });
+    }
+    return m_state != TokenizerState::Done;
+}
+
+void Tokenizer::restart(FileId file_id)
+{
+    if (m_locked_scanner != nullptr)
+        m_locked_scanner->abandon();
+    m_locked_scanner = nullptr;
+    m_current_scanner = nullptr;
+    m_file_id = file_id;
+    m_tokens = nullptr;
+    /*
+     * The dispatch table is built again, because a scanner can have been
+     * given new start characters since the last text, for example a
+     * KeywordScanner with an added keyword. Its vectors keep their capacity.
+     */
+    m_state = TokenizerState::Fresh;
+    reset();
+}
+
+void Tokenizer::prepare()
+{
+    if (m_state != TokenizerState::Fresh)
+        return;
     debug(lexer, "Scanners:");
     for (auto &scanner : m_scanners) {
         debug(lexer, "{} priority {}", scanner->name(), scanner->priority());
     }
-    m_tokens = &tokens;
-    while (tokens.empty() || tokens.back().code() != TokenCode::EndOfFile) {
-        match_token();
+    build_dispatch_table();
+    m_state = TokenizerState::Init;
+}
+
+/**
+ * Build, for every byte value, the list of scanners that can start a token
+ * with that byte, in priority order.
+ */
+void Tokenizer::build_dispatch_table()
+{
+    for (auto& candidates : m_dispatch)
+        candidates.clear();
+    for (auto& scanner : m_scanners) {
+        auto start_chars = scanner->start_characters();
+        for (auto ix = 0u; ix < m_dispatch.size(); ++ix) {
+            if (start_chars.test(ix))
+                m_dispatch[ix].push_back(scanner);
+        }
     }
-    oassert(!tokens.empty(), "tokenize() found no tokens, not even EOF");
-    oassert(tokens.back().code() == TokenCode::EndOfFile, "tokenize() did not leave an EOF");
-    return tokens;
 }
 
 void Tokenizer::match_token()
@@ -59,23 +169,26 @@ void Tokenizer::match_token()
     debug(lexer, "tokenizer::match_token");
     m_state = TokenizerState::Init;
 
+    auto windowed = m_buffer.more();
     if (m_locked_scanner != nullptr) {
+        if (windowed)
+            load_line();
         m_current_scanner = m_locked_scanner;
         auto name = m_locked_scanner->name();
         debug(lexer, "Matching with locked scanner '{}'", name);
         rewind();
+        auto mark = m_mark;
+        auto start = start_attempt(m_locked_scanner.get());
         m_locked_scanner->match(*this);
+        end_attempt(mark, start);
         oassert(m_state == TokenizerState::Success, "Match with locked scanner {} failed", name);
     } else {
-        for (auto &scanner: m_scanners) {
-            debug(lexer, "Matching with scanner '{}'", scanner->name());
-            m_current_scanner = scanner;
-            rewind();
-            scanner->match(*this);
-            if (m_state == TokenizerState::Success) {
-                debug(lexer, "Match with scanner {} succeeded", scanner->name());
-                break;
-            }
+        if (windowed) {
+            match_in_window();
+        } else if (m_dfa != nullptr) {
+            match_with_dfa();
+        } else {
+            match_with_scanners();
         }
 
         if (state() != TokenizerState::Success) {
@@ -85,6 +198,7 @@ void Tokenizer::match_token()
             if (ch > 0) {
                 push();
                 accept(TokenCode_by_char(ch));
+                count_catchall();
             }
         }
     }
@@ -92,9 +206,172 @@ void Tokenizer::match_token()
     if (m_buffer.eof()) {
         debug(lexer, "End-of-file. Accepting TokenCode::EndOfFile");
         accept(TokenCode::EndOfFile, "End of File Marker");
+        m_state = TokenizerState::Done;
+    }
+}
+
+/*
+ * Scanners that look at the text of the buffer directly take the end of
+ * the window for the end of the input. If a match went up to the end of the
+ * window, it may have been cut short. In that case the tokens it produced
+ * are dropped, and the match is done again with more input loaded.
+ */
+void Tokenizer::match_in_window()
+{
+    auto start = m_mark;
+    auto tokens = m_tokens->size();
+    m_buffer.hold(start);
+    while (true) {
+        auto limit = m_buffer.base() + m_buffer.buffer().length();
+        if (m_dfa != nullptr)
+            match_with_dfa();
+        else
+            match_with_scanners();
+        if (m_state != TokenizerState::Success || m_mark < limit || !m_buffer.more())
+            break;
+        debug(lexer, "Match ran into the end of the window at offset {}. Matching again with more input", limit);
+        m_tokens->erase(m_tokens->begin() + static_cast<long>(tokens), m_tokens->end());
+        if (m_locked_scanner != nullptr) {
+            m_locked_scanner->abandon();
+            unlock_scanner();
+        }
+        m_buffer.seek(start);
+        m_mark = start;
+        m_rewritten = false;
+        m_state = TokenizerState::Init;
+        (void) m_buffer.fill(2 * (limit - start) + 1);
+    }
+    m_buffer.release();
+}
+
+/*
+ * A locked scanner carries state from an earlier token that can't be
+ * restored, so its matches can't be done again like match_in_window()
+ * does. Locked scanners match at most the rest of a line, so that is
+ * loaded up front.
+ */
+void Tokenizer::load_line()
+{
+    while (m_buffer.more()) {
+        auto rest = m_buffer.buffer().substr(m_buffer.position());
+        if (find_any_of(rest, "\r\n") != std::string_view::npos)
+            return;
+        (void) m_buffer.fill(2 * rest.length() + 1);
+    }
+}
+
+void Tokenizer::match_with_scanners()
+{
+    auto const& candidates = m_dispatch[static_cast<unsigned char>(m_buffer.peek())];
+    for (auto &scanner: candidates) {
+        debug(lexer, "Matching with scanner '{}'", scanner->name());
+        m_current_scanner = scanner;
+        rewind();
+        auto mark = m_mark;
+        auto start = start_attempt(scanner.get());
+        scanner->match(*this);
+        end_attempt(mark, start);
+        if (m_state == TokenizerState::Success) {
+            debug(lexer, "Match with scanner {} succeeded", scanner->name());
+            break;
+        }
+    }
+}
+
+void Tokenizer::match_with_dfa()
+{
+    rewind();
+    /*
+     * All scanners run at once, so the time and the attempt are attributed
+     * to the scanner that wins. Time spent on input no scanner matches isn't
+     * attributed to any scanner.
+     */
+    auto mark = m_mark;
+    auto start = start_attempt(nullptr);
+    auto match_maybe = [this]() {
+        while (true) {
+            size_t scanned;
+            auto ret = m_dfa->match(m_buffer.buffer(), m_buffer.position(), m_buffer.top(), &scanned);
+            if (!m_buffer.more() || m_buffer.position() + scanned <= m_buffer.buffer().length())
+                return ret;
+            // The DFA read past the end of the window. Matching is side
+            // effect free, so match again with more input:
+            (void) m_buffer.fill(2 * scanned);
+        }
+    }();
+    if (!match_maybe.has_value())
+        return;
+    auto const& match = match_maybe.value();
+    m_current_scanner = m_dfa->scanners()[match.scanner];
+    debug(lexer, "DFA matched {} characters with scanner '{}'", match.length, m_current_scanner->name());
+    matching(m_current_scanner.get());
+    if (match.action.rewrite) {
+        // The token value isn't a slice of the input. Have the scanner build it:
+        m_current_scanner->match(*this);
+        oassert(m_state == TokenizerState::Success, "Scanner {} did not match DFA match", m_current_scanner->name());
+    } else {
+        m_buffer.skip(match.length);
+        if (match.action.skip) {
+            skip();
+        } else {
+            auto value = m_buffer.scanned_string();
+            m_current_scanner->accept(*this, match.action.code, value.substr(match.action.trim_front, value.length() - match.action.trim_front - match.action.trim_back));
+        }
+    }
+    end_attempt(mark, start);
+}
+
+#ifdef OBL_LEXER_STATISTICS
+
+static uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/*
+ * Bookkeeping around a call to Scanner::match() when collecting statistics.
+ * end_attempt() takes the position the match started at.
+ */
+uint64_t Tokenizer::start_attempt(Scanner const* scanner)
+{
+    m_matching = scanner;
+    return cycles();
+}
+
+void Tokenizer::end_attempt(size_t start_position, uint64_t start)
+{
+    auto& stats = statistics_for(m_matching);
+    ++stats.attempts;
+    if (m_state == TokenizerState::Success) {
+        ++stats.successes;
+        stats.bytes += m_buffer.offset() - start_position;
     }
+    stats.cycles += cycles() - start;
+    m_matching = nullptr;
 }
 
+void Tokenizer::count_rewind()
+{
+    if (m_matching != nullptr)
+        ++statistics_for(m_matching).rewinds;
+}
+
+ScannerStatistics& Tokenizer::statistics_for(Scanner const* scanner)
+{
+    auto it = m_statistics_index.find(scanner);
+    if (it == m_statistics_index.end()) {
+        auto& stats = m_statistics.scanner(scanner->name());
+        it = m_statistics_index.emplace(scanner, &stats - m_statistics.scanners.data()).first;
+    }
+    return m_statistics.scanners[it->second];
+}
+
+#endif
+
 /*
 void Tokenizer::chop(size_t num)
 {;
@@ -123,20 +400,18 @@ bool Tokenizer::at_end() const
 void Tokenizer::rewind()
 {
     debug(lexer, "Rewinding tokenizer");
-    m_token_string.reset();
+    count_rewind();
+    m_rewritten = false;
     m_buffer.rewind();
 }
 
 void Tokenizer::partial_rewind(size_t num)
 {
+    count_rewind();
     if (num > m_buffer.scanned())
         num = m_buffer.scanned();
-    if (m_token_string.has_value()) {
-        if (num < m_buffer.scanned())
-            m_token_string = m_token_string->substr(0, m_buffer.scanned() - num);
-        else
-            m_token_string->clear();
-    }
+    if (m_rewritten)
+        m_token_string.resize(std::min(m_token_string.length(), m_buffer.scanned() - num));
     m_buffer.partial_rewind(num);
 }
 
@@ -145,38 +420,49 @@ void Tokenizer::partial_rewind(size_t num)
  */
 void Tokenizer::reset() {
     debug(lexer, "Resetting tokenizer");
-    auto scanned = m_buffer.scanned_string();
-    for (auto ix = 0u; ix < scanned.length(); ++ix) {
-        auto ch = scanned[ix];
-        if (ch == '\r' && ix < scanned.length()-1 && scanned[ix+1] == '\n')
-            ch = scanned[++ix];
-        if (ch == '\n' || ch == '\r') {
-            m_mark.line++;
-            m_mark.column = 1;
-        } else {
-            m_mark.column++;
-        }
-    }
-    m_mark.index += scanned.length();
+    m_mark = m_buffer.offset();
     m_buffer.reset();
-    m_token_string.reset();
+    m_rewritten = false;
 }
 
 std::string_view Tokenizer::current_token() const
 {
-    if (m_token_string.has_value())
-        return std::string_view(m_token_string.value());
-    else
-        return m_buffer.scanned_string();
+    if (m_rewritten)
+        return m_token_string;
+    return m_buffer.scanned_string();
+}
+
+void Tokenizer::accept(TokenCode code, Token::Number number)
+{
+    accept(code, current_token(), number);
 }
 
-void Tokenizer::accept(TokenCode code)
+void Tokenizer::accept(TokenCode code, std::string_view value, Token::Number number)
 {
-    if (m_token_string.has_value()) {
-        accept(code, m_token_string.value());
+    auto mark = m_mark;
+    if (m_filtered_codes.contains(code)) {
+        skip();
         return;
     }
-    accept(code, m_buffer.scanned_string());
+    /*
+     * Text built in m_token_string is overwritten by the next token, so it
+     * is moved to the arena. Slices of the buffer are used as-is, unless the
+     * text of a windowed buffer gets overwritten when it loads more input.
+     */
+    auto within = [&value](std::string_view text) {
+        return value.data() >= text.data() && value.data() <= text.data() + text.length();
+    };
+    if ((m_rewritten && within(m_token_string)) || (m_buffer.transient() && within(m_buffer.buffer())))
+        value = m_arena->add(value);
+    skip();
+    m_tokens->emplace_back(code, value, mark, m_mark, m_file_id, m_lines);
+    m_tokens->back().number(number);
+    debug(lexer, "Lexer::accept({})", m_tokens->back());
+}
+
+void Tokenizer::accept(TokenCode code, std::string const& value, Token::Number number)
+{
+    accept(code, m_arena->add(value), number);
 }
 
 void Tokenizer::skip()
@@ -189,28 +475,66 @@ void Tokenizer::chop(size_t num)
 {
     if (num < 1)
         return;
-    if (!m_token_string.has_value())
-        m_token_string = current_token();
-    if (num > m_token_string->length())
-        num = m_token_string->length();
-    m_token_string = m_token_string->substr(0, m_token_string->length()-num);
+    if (!m_rewritten) {
+        m_token_string.assign(current_token());
+        m_rewritten = true;
+    }
+    if (num > m_token_string.length())
+        num = m_token_string.length();
+    m_token_string.resize(m_token_string.length() - num);
 }
 
 void Tokenizer::push() {
-    if (m_token_string.has_value()) {
-        m_token_string.value() += (char) m_buffer.peek();
-    }
+    if (m_rewritten)
+        m_token_string += (char) m_buffer.peek();
     m_buffer.skip();
     m_current = 0;
 }
 
+/**
+ * Push the next num characters in one step. Stops at the end of the buffer.
+ */
+void Tokenizer::push(size_t num)
+{
+    (void) advance(num);
+}
+
+std::string_view Tokenizer::advance(size_t num)
+{
+    return pushed(m_buffer.read(num));
+}
+
+std::string_view Tokenizer::scan_while(ByteClass const& bytes)
+{
+    return pushed(m_buffer.scan_while(bytes));
+}
+
+std::string_view Tokenizer::scan_until(std::string_view bytes)
+{
+    return pushed(m_buffer.scan_until(bytes));
+}
+
+std::string_view Tokenizer::find(std::string_view text)
+{
+    return pushed(m_buffer.find(text));
+}
+
+std::string_view Tokenizer::pushed(std::string_view text)
+{
+    if (m_rewritten)
+        m_token_string += text;
+    m_current = 0;
+    return text;
+}
+
 void Tokenizer::push_as(int ch) {
     if (ch != m_buffer.peek()) {
-        if (!m_token_string.has_value()) {
-            m_token_string = (m_buffer.scanned()) ? current_token() : "";
+        if (!m_rewritten) {
+            m_token_string.assign(current_token());
+            m_rewritten = true;
         }
         if (ch) {
-            m_token_string.value() += (char)ch;
+            m_token_string += (char)ch;
         }
         m_buffer.skip();
         m_current = 0;
@@ -237,6 +561,16 @@ void Tokenizer::add_scanners(std::set<std::shared_ptr<Scanner>> scanners)
     m_scanners.merge(scanners);
 }
 
+std::shared_ptr<LexerDfa> Tokenizer::compile_dfa() const
+{
+    return LexerDfa::compile({ m_scanners.begin(), m_scanners.end() });
+}
+
+void Tokenizer::use_dfa(std::shared_ptr<LexerDfa> dfa)
+{
+    m_dfa = std::move(dfa);
+}
+
 std::shared_ptr<Scanner> Tokenizer::get_scanner(std::string const& name)
 {
     for (auto& scanner : m_scanners) {
@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <array>
 #include <functional>
 #include <map>
 #include <memory>
@@ -15,8 +16,10 @@
 #include <unordered_set>
 #include <vector>
 
+#include <core/StringArena.h>
 #include <core/StringBuffer.h>
 #include <functional>
+#include <lexer/Automaton.h>
 #include <lexer/Token.h>
 
 namespace Obelix {
@@ -52,6 +55,36 @@ constexpr char const* TokenizerState_name(TokenizerState state)
     }
 }
 
+#ifdef OBL_LEXER_STATISTICS
+constexpr static bool LexerStatistics = true;
+#else
+constexpr static bool LexerStatistics = false;
+#endif
+
+/**
+ * What the Tokenizer did with the scanners with one name. Only collected if
+ * the lexer is built with OBL_LEXER_STATISTICS; otherwise the counting code
+ * is compiled out.
+ */
+struct ScannerStatistics {
+    std::string scanner;
+    size_t attempts { 0 };
+    size_t successes { 0 };
+    size_t bytes { 0 };   // Consumed by successful matches
+    size_t rewinds { 0 }; // rewind() and partial_rewind() calls by the scanner
+    uint64_t cycles { 0 };
+};
+
+struct TokenizerStatistics {
+    std::vector<ScannerStatistics> scanners {};
+    size_t catchall { 0 }; // Single-character tokens from TokenCode_by_char
+
+    ScannerStatistics& scanner(std::string_view name);
+    void merge(TokenizerStatistics const&);
+    [[nodiscard]] std::string to_string() const;
+};
+
+class LexerDfa;
 class Tokenizer;
 class Scanner;
 
@@ -68,6 +101,49 @@ public:
     [[nodiscard]] virtual char const* name() const = 0;
     virtual void match(Tokenizer&) { }
 
+    /**
+     * The set of bytes a token matched by this scanner can start with. The
+     * Tokenizer only tries a scanner if the next byte is in this set. The
+     * default is every byte, which is what custom scanners need.
+     */
+    [[nodiscard]] virtual CharacterSet start_characters() const { return CharacterSet {}.set(); }
+
+    /**
+     * An automaton matching exactly what match() matches, for use by the
+     * LexerDfa engine. Scanners that can't be expressed as an automaton, in
+     * general or in their current configuration, return an empty value.
+     */
+    [[nodiscard]] virtual std::optional<ScannerAutomaton> automaton() const { return {}; }
+
+    /**
+     * Accepts a token with the given value, which is a slice of the input
+     * matched by this scanner's automaton. Scanners that derive more than
+     * the text from a token, like NumberScanner, override this so the
+     * LexerDfa engine produces the same tokens as match().
+     */
+    virtual void accept(Tokenizer&, TokenCode, std::string_view) const;
+
+    /**
+     * A copy of this scanner with the same configuration but its own
+     * matching state, so that it can be used by a Tokenizer running on
+     * another thread. Scanners that can't be copied safely, like custom
+     * scanners wrapping arbitrary code, return nullptr.
+     */
+    [[nodiscard]] virtual std::shared_ptr<Scanner> clone() const { return nullptr; }
+
+    /**
+     * Builds the tables match() would otherwise build on its first call,
+     * so that clones of this scanner copy them instead of each building
+     * them again. Called on the scanners of a LexerSpec when it is built.
+     */
+    virtual void freeze() { }
+
+    /**
+     * Drops the state a locked scanner carries over to its next match,
+     * because the Tokenizer is starting over on a new text.
+     */
+    virtual void abandon() { }
+
     bool operator<(Obelix::Scanner const& other) const
     {
         if (priority() != other.priority())
@@ -81,8 +157,17 @@ private:
 
 class Tokenizer {
 public:
-    explicit Tokenizer(std::string_view const&, std::string = {});
-    explicit Tokenizer(StringBuffer&, std::string = {});
+    explicit Tokenizer(std::string_view const&, std::string const& = {});
+    explicit Tokenizer(StringBuffer&, std::string const& = {});
+    Tokenizer(StringBuffer&, FileId);
+
+    /**
+     * A Tokenizer starting at the given offset of the text of buffer. It
+     * keeps its own position, so several of them can work on the same
+     * buffer at the same time. Tokens have offsets into, and refer to the
+     * line index of, buffer.
+     */
+    Tokenizer(StringBuffer const& buffer, size_t offset, FileId);
 
     template<typename... Args>
     void filter_codes(TokenCode code, Args&&... args)
@@ -104,29 +189,100 @@ public:
 
     std::vector<Token> const& tokenize(std::vector<Token>& tokens);
 
+    /**
+     * Tokenizes until tokens holds at least size tokens, or until the end
+     * of the buffer. Can be called repeatedly to tokenize a buffer
+     * incrementally. Returns false once the EndOfFile token was produced.
+     */
+    bool tokenize(std::vector<Token>& tokens, size_t size);
+
+    /**
+     * A position between two tokens where no scanner was locked, and the
+     * number of tokens produced before it. Two Tokenizers with the same
+     * scanners passing the same sync point produce the same tokens from
+     * there on.
+     */
+    struct SyncPoint {
+        size_t offset;
+        size_t tokens;
+    };
+
+    /**
+     * Tokenizes until the position is at or past offset, or until the end
+     * of the buffer. If sync_points is given, the sync points passed are
+     * appended to it. Returns false once the EndOfFile token was produced.
+     */
+    bool tokenize_until(std::vector<Token>& tokens, size_t offset, std::vector<SyncPoint>* sync_points = nullptr);
+
+    /**
+     * Starts over at the current position of the buffer, which usually got
+     * a new text assigned. The scanners, the dispatch table and the scratch
+     * space are kept, so this doesn't allocate.
+     */
+    void restart(FileId);
+
+#ifdef OBL_LEXER_STATISTICS
+    [[nodiscard]] TokenizerStatistics const& statistics() const { return m_statistics; }
+    void reset_statistics()
+    {
+        m_statistics = {};
+        m_statistics_index.clear();
+    }
+#else
+    [[nodiscard]] TokenizerStatistics const& statistics() const
+    {
+        static TokenizerStatistics const s_empty {};
+        return s_empty;
+    }
+    void reset_statistics() { }
+#endif
+
+    /**
+     * The offset of the position in the whole input.
+     */
+    [[nodiscard]] size_t position() const { return m_buffer.offset(); }
+    [[nodiscard]] bool synchronized() const { return m_locked_scanner == nullptr; }
+
     [[nodiscard]] int peek(int num = 0);
     void discard();
     [[nodiscard]] std::string_view current_token() const;
-    void accept(TokenCode);
+    void accept(TokenCode, Token::Number = {});
 
-    template <typename Str>
-    void accept(TokenCode code, Str value)
-    {
-        auto mark = m_mark;
-        skip();
-        if (m_filtered_codes.contains(code))
-            return;
-        m_tokens->emplace_back(Span { m_file_name, mark, m_mark }, code, value);
-        debug(lexer, "Lexer::accept({})", m_tokens->back());
-    }
+    /**
+     * Accepts a token with the given text. The text must outlive the token:
+     * a slice of the buffer, a string literal, or a string stored in the
+     * arena. The std::string overload copies the text into the arena.
+     */
+    void accept(TokenCode, std::string_view, Token::Number = {});
+    void accept(TokenCode, std::string const&, Token::Number = {});
 
-    template <>
     void accept(TokenCode code, const char* value)
     {
         accept(code, std::string_view(value));
     }
 
+    /**
+     * The arena holding token text that isn't a slice of the buffer. It
+     * must outlive the tokens; a Lexer hands its own arena to the
+     * Tokenizers it creates.
+     */
+    [[nodiscard]] StringArena& arena() { return *m_arena; }
+    void arena(std::shared_ptr<StringArena> arena) { m_arena = std::move(arena); }
+
     void push();
+    void push(size_t);
+
+    /**
+     * Bulk versions of push(), for scanners that consume runs of characters.
+     * They push the run in one step, stopping at the end of the input, and
+     * return the text pushed. See StringBuffer::scan_while() and friends;
+     * like the text returned there, it is only valid until more input is
+     * pushed.
+     */
+    std::string_view advance(size_t);
+    std::string_view scan_while(ByteClass const&);
+    std::string_view scan_until(std::string_view);
+    std::string_view find(std::string_view);
     void push_as(int);
     void skip();
     void chop(size_t = 1);
@@ -140,6 +296,8 @@ public:
 
     void add_scanners(std::set<std::shared_ptr<Scanner>>);
     std::shared_ptr<Scanner> get_scanner(std::string const&);
+    [[nodiscard]] std::shared_ptr<LexerDfa> compile_dfa() const;
+    void use_dfa(std::shared_ptr<LexerDfa>);
     void lock_scanner();
     void unlock_scanner();
 
@@ -152,7 +310,33 @@ public:
     }
 
 private:
+    void prepare();
+    void build_dispatch_table();
     void match_token();
+    void match_in_window();
+    void load_line();
+    std::string_view pushed(std::string_view);
+    void match_with_scanners();
+    void match_with_dfa();
+
+    /*
+     * Bookkeeping for the statistics. Without OBL_LEXER_STATISTICS these
+     * do nothing, and the Tokenizer has no members to keep them in.
+     */
+#ifdef OBL_LEXER_STATISTICS
+    [[nodiscard]] uint64_t start_attempt(Scanner const*);
+    void end_attempt(size_t, uint64_t);
+    void matching(Scanner const* scanner) { m_matching = scanner; }
+    void count_rewind();
+    void count_catchall() { ++m_statistics.catchall; }
+    ScannerStatistics& statistics_for(Scanner const*);
+#else
+    [[nodiscard]] uint64_t start_attempt(Scanner const*) { return 0; }
+    void end_attempt(size_t, uint64_t) { }
+    void matching(Scanner const*) { }
+    void count_rewind() { }
+    void count_catchall() { }
+#endif
 
     std::unordered_set<TokenCode> m_filtered_codes {};
 
@@ -164,16 +348,29 @@ private:
     };
 
     std::set<std::shared_ptr<Scanner>, ScannerCmp> m_scanners {};
+    std::array<std::vector<std::shared_ptr<Scanner>>, 256> m_dispatch {};
     std::optional<StringBuffer> m_string_buffer {};
     StringBuffer& m_buffer;
-    std::optional<std::string> m_token_string {};
+    LineIndex const* m_lines;
+    // Scratch space for the token text when a scanner rewrote it. Only
+    // valid if m_rewritten is set; kept between tokens to reuse its storage.
+    std::string m_token_string {};
+    bool m_rewritten { false };
+    std::shared_ptr<StringArena> m_arena { std::make_shared<StringArena>() };
     TokenizerState m_state { TokenizerState::Fresh };
     std::vector<Token>* m_tokens { nullptr };
     int m_current { 0 };
-    std::string m_file_name;
-    Location m_mark { 0, 1, 1 };
+    FileId m_file_id { SourceFiles::NoFile };
+    size_t m_mark { 0 };
     std::shared_ptr<Scanner> m_current_scanner;
     std::shared_ptr<Scanner> m_locked_scanner { nullptr };
+    std::shared_ptr<LexerDfa> m_dfa { nullptr };
+
+#ifdef OBL_LEXER_STATISTICS
+    TokenizerStatistics m_statistics {};
+    std::unordered_map<Scanner const*, size_t> m_statistics_index {};
+    Scanner const* m_matching { nullptr }; // The scanner in match(), if any
+#endif
 };
 
 class CustomScanner : public Scanner {
@@ -207,11 +404,15 @@ public:
     [[nodiscard]] std::string quotes() const { return m_quotes; }
     void match(Tokenizer& tokenizer) override;
     [[nodiscard]] char const* name() const override { return "qstring"; }
+    [[nodiscard]] std::shared_ptr<Scanner> clone() const override { return std::make_shared<QStringScanner>(*this); }
+    [[nodiscard]] CharacterSet start_characters() const override;
+    [[nodiscard]] std::optional<ScannerAutomaton> automaton() const override;
 
 private:
+    static TokenCode unclosed_code(char);
+
     std::string m_quotes;
     char m_quote {};
-    QStrState m_state { QStrState::Init };
     bool m_verbatim { false };
 };
 
@@ -239,6 +440,9 @@ public:
     explicit WhitespaceScanner(bool);
     void match(Tokenizer&) override;
     [[nodiscard]] char const* name() const override { return "whitespace"; }
+    [[nodiscard]] std::shared_ptr<Scanner> clone() const override { return std::make_shared<WhitespaceScanner>(*this); }
+    [[nodiscard]] CharacterSet start_characters() const override;
+    [[nodiscard]] std::optional<ScannerAutomaton> automaton() const override;
 
 private:
     Config m_config {};
@@ -324,10 +528,15 @@ public:
 
     void match(Tokenizer&) override;
     [[nodiscard]] char const* name() const override { return "comment"; }
+    [[nodiscard]] std::shared_ptr<Scanner> clone() const override;
+    void abandon() override;
+    [[nodiscard]] CharacterSet start_characters() const override;
+    [[nodiscard]] std::optional<ScannerAutomaton> automaton() const override;
 
 private:
     void find_eol(Tokenizer&);
     void find_end_marker(Tokenizer&);
+    void accept_line(Tokenizer&);
 
     std::vector<CommentMarker> m_markers {};
     bool m_split_by_lines { false };
@@ -374,9 +583,22 @@ public:
     explicit NumberScanner(Config const&);
     void match(Tokenizer&) override;
     [[nodiscard]] char const* name() const override { return "number"; }
+    [[nodiscard]] std::shared_ptr<Scanner> clone() const override { return std::make_shared<NumberScanner>(*this); }
+    [[nodiscard]] CharacterSet start_characters() const override;
+    [[nodiscard]] std::optional<ScannerAutomaton> automaton() const override;
+    void accept(Tokenizer&, TokenCode, std::string_view) const override;
 
 private:
+    struct Transition {
+        NumberScannerState state;
+        TokenCode code { TokenCode::Unknown };
+        bool chop { false };
+        bool rewind { false };
+    };
+
+    [[nodiscard]] Transition transition(NumberScannerState, int) const;
     TokenCode process(Tokenizer&, int);
+    [[nodiscard]] static std::optional<Token::Number> decode(TokenCode, std::string_view);
 
     NumberScannerState m_state { NumberScannerState::None };
     Config m_config {};
@@ -416,11 +638,21 @@ public:
     explicit IdentifierScanner(Config);
     void match(Tokenizer&) override;
     [[nodiscard]] char const* name() const override { return "identifier"; }
+    [[nodiscard]] std::shared_ptr<Scanner> clone() const override { return std::make_shared<IdentifierScanner>(*this); }
+    [[nodiscard]] CharacterSet start_characters() const override;
+    [[nodiscard]] std::optional<ScannerAutomaton> automaton() const override;
 
 private:
-    bool filter_character(Tokenizer&, int) const;
+    static bool filter_against(int, std::string const&, IdentifierCharacterClass, bool);
+    void build_tables();
 
     Config m_config {};
+
+    // The Config compiled into lookup tables indexed by byte value.
+    std::array<bool, 256> m_starts {};
+    std::array<bool, 256> m_continues {};
+    std::array<char, 256> m_fold {};
+    bool m_folds { false };
 };
 
 #define ENUMERATE_KEYWORD_SCANNER_STATES(S) \
@@ -479,6 +711,11 @@ public:
 
     void match(Tokenizer&) override;
     [[nodiscard]] char const* name() const override { return "keyword"; }
+    [[nodiscard]] std::shared_ptr<Scanner> clone() const override { return std::make_shared<KeywordScanner>(*this); }
+    void freeze() override;
+    [[nodiscard]] bool frozen() const { return !m_nodes.empty() || m_keywords.empty(); }
+    [[nodiscard]] CharacterSet start_characters() const override;
+    [[nodiscard]] std::optional<ScannerAutomaton> automaton() const override;
 
     template<typename... Args>
     void add_keywords(TokenCode code, std::string text, Args&&... args)
@@ -531,17 +768,32 @@ public:
     }
 
 private:
+    /*
+     * A node of the keyword trie, i.e. a prefix of one or more keywords.
+     * The outgoing edges of a node are stored sorted by byte in the
+     * m_edge_bytes/m_edge_targets slice [first_edge, first_edge + edges).
+     */
+    struct TrieNode {
+        uint32_t first_edge { 0 };
+        uint32_t edges { 0 };
+        uint32_t count { 0 }; // Number of keywords starting with this prefix
+        int keyword { -1 };   // Index of the keyword equal to this prefix
+    };
+
     void reset();
+    void build_trie();
+    uint32_t build_node(std::vector<uint32_t> const&, size_t, size_t, size_t);
+    [[nodiscard]] int child(uint32_t, int) const;
     void match_character(int);
     static size_t s_next_identifier;
 
     std::vector<Keyword> m_keywords;
+    std::vector<TrieNode> m_nodes {};
+    std::vector<unsigned char> m_edge_bytes {};
+    std::vector<uint32_t> m_edge_targets {};
     KeywordScannerState m_state { KeywordScannerState::Init };
-    size_t m_matchcount { 0 };
-    size_t m_match_min { 0 };
-    size_t m_match_max { 0 };
+    uint32_t m_node { 0 };
     int m_fullmatch = -1;
-    std::string m_scanned {};
 
     bool m_case_sensitive { true };
 };
@@ -8,6 +8,7 @@
 // Created by Jan de Visser on 2021-10-05.
 //
 
+#include <core/ByteScan.h>
 #include <lexer/Tokenizer.h>
 
 namespace Obelix {
@@ -32,128 +33,93 @@ WhitespaceScanner::WhitespaceScanner(bool ignore_all_ws)
     }
 }
 
-void WhitespaceScanner::match(Tokenizer& tokenizer) {
-    int ch;
+CharacterSet WhitespaceScanner::start_characters() const
+{
+    CharacterSet ret;
+    for (auto ch : std::string_view(" \t\n\v\f\r"))
+        ret.set(static_cast<unsigned char>(ch));
+    return ret;
+}
 
-    for (m_state = WhitespaceState::Init, ch = tokenizer.peek();
-         ch && m_state != WhitespaceState::Done; ch = tokenizer.peek()) {
-#if 0
-        if ((ch == '\n' || ch == '\r') && !m_config.newlines_are_spaces) {
-            if (m_state == WhitespaceState::Whitespace) {
-                if (m_config.ignore_spaces) {
-                    tokenizer.skip();
-                } else {
-                    tokenizer.accept(TokenCode::Whitespace);
-                }
-            }
-            if (ch == '\r') {
-                ch = tokenizer.peek(1);
-                if (ch == '\n') {
-                    tokenizer.discard();
-                    tokenizer.push();
-                } else {
-                    tokenizer.push_as('\n');
-                }
-            } else {
-                tokenizer.push();
-            }
-            if (m_config.ignore_newlines) {
-                tokenizer.skip();
-            } else {
-                tokenizer.accept(TokenCode::NewLine);
-            }
-            m_state = WhitespaceState::Done;
-            continue;
-        }
-#endif
-        switch (m_state) {
-            case WhitespaceState::Init:
-                if (isspace(ch)) {
-                    if (ch == '\r' || ch == '\n') {
-                        if (!m_config.newlines_are_spaces) {
-                            if (ch == '\r') {
-                                ch = tokenizer.peek(1);
-                                if (ch == '\n') {
-                                    tokenizer.discard();
-                                    tokenizer.push();
-                                } else {
-                                    tokenizer.push_as('\n');
-                                }
-                            } else {
-                                tokenizer.push();
-                            }
-                            if (m_config.ignore_newlines) {
-                                tokenizer.skip();
-                            } else {
-                                tokenizer.accept(TokenCode::NewLine);
-                            }
-                            m_state = WhitespaceState::Done;
-                        } else {
-                            tokenizer.push();
-                            m_state = WhitespaceState::Whitespace;
-                        }
-                    } else {
-                        tokenizer.push();
-                        m_state = WhitespaceState::Whitespace;
-                    }
-                } else {
-                    m_state = WhitespaceState::Done;
-                }
-                break;
-            case WhitespaceState::Whitespace:
-                if (isspace(ch)) {
-                    if (ch == '\r' || ch == '\n') {
-                        if (!m_config.newlines_are_spaces) {
-                            if (m_config.ignore_spaces) {
-                                tokenizer.skip();
-                            } else {
-                                tokenizer.accept(TokenCode::Whitespace);
-                            }
-                            if (ch == '\r') {
-                                ch = tokenizer.peek(1);
-                                if (ch == '\n') {
-                                    tokenizer.discard();
-                                    tokenizer.push();
-                                } else {
-                                    tokenizer.push_as('\n');
-                                }
-                            } else {
-                                tokenizer.push();
-                            }
-                            if (m_config.ignore_newlines) {
-                                tokenizer.skip();
-                            } else {
-                                tokenizer.accept(TokenCode::NewLine);
-                            }
-                            m_state = WhitespaceState::Done;
-                        } else {
-                            tokenizer.push();
-                            m_state = WhitespaceState::Whitespace;
-                        }
-                    } else {
-                        tokenizer.push();
-                        m_state = WhitespaceState::Whitespace;
-                    }
-                } else {
-                    if (m_config.ignore_spaces) {
-                        tokenizer.skip();
-                    } else {
-                        tokenizer.accept(TokenCode::Whitespace);
-                    }
-                    m_state = WhitespaceState::Done;
-                }
-                break;
-            default:
-                break;
+std::optional<ScannerAutomaton> WhitespaceScanner::automaton() const
+{
+    ScannerAutomaton ret;
+    auto init = ret.add_state();
+    auto whitespace = ret.add_state();
+    auto lf = ret.add_state();
+    auto cr = ret.add_state();
+    auto crlf = ret.add_state();
+    auto accept_whitespace = ret.accept({ TokenCode::Whitespace, m_config.ignore_spaces });
+    auto accept_lf = ret.accept({ TokenCode::NewLine, m_config.ignore_newlines });
+
+    /*
+     * A '\r' or "\r\n" newline is normalized to "\n", so unless the token
+     * is dropped the scanner has to build it:
+     */
+    auto accept_cr = ret.accept({ TokenCode::NewLine, m_config.ignore_newlines, !m_config.ignore_newlines });
+
+    for (auto ix = 0u; ix < 256; ++ix) {
+        int ch = peek_value(ix);
+        auto is_newline = (ch == '\r') || (ch == '\n');
+        if (!isspace(ch)) {
+            ret.transition(whitespace, ix, accept_whitespace);
+        } else if (is_newline && !m_config.newlines_are_spaces) {
+            ret.transition(init, ix, (ch == '\r') ? cr : lf);
+            ret.transition(whitespace, ix, accept_whitespace);
+            ret.chains.set(ix);
+        } else {
+            ret.transition(init, ix, whitespace);
+            ret.transition(whitespace, ix, whitespace);
         }
+        ret.transition(lf, ix, accept_lf);
+        ret.transition(cr, ix, (ch == '\n') ? crlf : accept_cr);
+        ret.transition(crlf, ix, accept_cr);
     }
-    if (!ch && m_state == WhitespaceState::Whitespace) {
+    ret.start = ret.start_at_top = init;
+    return ret;
+}
+
+void WhitespaceScanner::match(Tokenizer& tokenizer)
+{
+    m_state = WhitespaceState::Init;
+    int ch = tokenizer.peek();
+    if (!isspace(ch))
+        return;
+
+    /*
+     * Consume the whole run of blanks in one go. If newlines aren't spaces
+     * the run stops at a newline, which becomes a token of its own.
+     */
+    auto const& buffer = tokenizer.buffer();
+    auto blanks = whitespace_span(buffer.buffer().substr(buffer.position()), m_config.newlines_are_spaces);
+    if (blanks > 0) {
+        tokenizer.push(blanks);
         if (m_config.ignore_spaces) {
             tokenizer.skip();
         } else {
             tokenizer.accept(TokenCode::Whitespace);
         }
+        m_state = WhitespaceState::Whitespace;
+        ch = tokenizer.peek();
+    }
+    if ((ch == '\r' || ch == '\n') && !m_config.newlines_are_spaces) {
+        if (ch == '\r') {
+            if (tokenizer.peek(1) == '\n') {
+                tokenizer.discard();
+                tokenizer.push();
+            } else {
+                tokenizer.push_as('\n');
+            }
+        } else {
+            tokenizer.push();
+        }
+        if (m_config.ignore_newlines) {
+            tokenizer.skip();
+        } else {
+            tokenizer.accept(TokenCode::NewLine);
+        }
     }
+    m_state = WhitespaceState::Done;
 }
 
 }
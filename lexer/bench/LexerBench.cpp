@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#include <benchmark/benchmark.h>
+
+#include <lexer/BasicParser.h>
+
+namespace Obelix {
+
+/*
+ * The corpora are generated with a fixed seed, so every run of the benchmarks
+ * lexes the same text. The mixed corpus is a checked-in C-like source file,
+ * repeated until it is large enough.
+ */
+
+#define ENUMERATE_CORPORA(S) \
+    S(Identifiers)           \
+    S(Numbers)               \
+    S(Strings)               \
+    S(Comments)              \
+    S(Mixed)
+
+enum class Corpus {
+#undef _CORPUS
+#define _CORPUS(corpus) corpus,
+    ENUMERATE_CORPORA(_CORPUS)
+#undef _CORPUS
+};
+
+static std::string generate_identifiers(std::mt19937& rnd, size_t size)
+{
+    static constexpr char const* chars = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ_0123456789";
+    std::string ret;
+    while (ret.length() < size) {
+        auto length = 1 + rnd() % 16;
+        ret += chars[rnd() % 53];
+        for (auto ix = 1u; ix < length; ++ix)
+            ret += chars[rnd() % 63];
+        ret += (rnd() % 8) ? ' ' : '\n';
+    }
+    return ret;
+}
+
+static std::string generate_numbers(std::mt19937& rnd, size_t size)
+{
+    std::string ret;
+    while (ret.length() < size) {
+        switch (rnd() % 3) {
+        case 0:
+            ret += std::to_string(rnd() % 1000000);
+            break;
+        case 1:
+            ret += std::to_string(rnd() % 1000) + "." + std::to_string(rnd() % 100000) + "e-" + std::to_string(rnd() % 20);
+            break;
+        default:
+            ret += format("0x{x}", rnd());
+            break;
+        }
+        ret += (rnd() % 8) ? ' ' : '\n';
+    }
+    return ret;
+}
+
+static std::string generate_strings(std::mt19937& rnd, size_t size)
+{
+    std::string ret;
+    while (ret.length() < size) {
+        auto quote = (rnd() % 2) ? '"' : '\'';
+        ret += quote;
+        for (auto length = rnd() % 64; length > 0; --length) {
+            if (rnd() % 16 == 0) {
+                ret += '\\';
+                ret += "nt\\"[rnd() % 3];
+            } else {
+                ret += static_cast<char>('a' + rnd() % 26);
+            }
+        }
+        ret += quote;
+        ret += (rnd() % 8) ? ' ' : '\n';
+    }
+    return ret;
+}
+
+static std::string generate_comments(std::mt19937& rnd, size_t size)
+{
+    std::string ret;
+    while (ret.length() < size) {
+        auto block = rnd() % 2;
+        ret += (block) ? "/*" : "//";
+        for (auto length = rnd() % 120; length > 0; --length) {
+            auto ch = rnd() % 32;
+            ret += (block && ch == 0) ? '\n' : (ch < 6) ? ' ' : static_cast<char>('a' + ch - 6);
+        }
+        ret += (block) ? "*/\n" : "\n";
+        ret += "x;\n";
+    }
+    return ret;
+}
+
+static std::string generate_mixed(size_t size)
+{
+    static std::string s_source = []() {
+        std::ifstream file(OBL_BENCH_CORPUS_DIR "/mixed.c");
+        if (!file)
+            fatal("Could not open {}", OBL_BENCH_CORPUS_DIR "/mixed.c");
+        std::stringstream ss;
+        ss << file.rdbuf();
+        return ss.str();
+    }();
+    std::string ret;
+    ret.reserve(size + s_source.length());
+    while (ret.length() < size)
+        ret += s_source;
+    return ret;
+}
+
+/*
+ * Only the corpus of the running benchmark is kept. With sizes up to 100 MB,
+ * keeping all of them would take gigabytes. Generating one is not part of
+ * the measured time.
+ */
+static std::string const& corpus(Corpus corpus, size_t size)
+{
+    static std::pair<Corpus, size_t> s_key { Corpus::Mixed, 0 };
+    static std::string s_corpus;
+    if (s_key == std::make_pair(corpus, size) && !s_corpus.empty())
+        return s_corpus;
+
+    std::string().swap(s_corpus);
+    std::mt19937 rnd(static_cast<unsigned>(corpus) + 1);
+    switch (corpus) {
+    case Corpus::Identifiers:
+        s_corpus = generate_identifiers(rnd, size);
+        break;
+    case Corpus::Numbers:
+        s_corpus = generate_numbers(rnd, size);
+        break;
+    case Corpus::Strings:
+        s_corpus = generate_strings(rnd, size);
+        break;
+    case Corpus::Comments:
+        s_corpus = generate_comments(rnd, size);
+        break;
+    case Corpus::Mixed:
+        s_corpus = generate_mixed(size);
+        break;
+    }
+    s_key = { corpus, size };
+    return s_corpus;
+}
+
+/*
+ * The scanner configurations, from only identifiers and whitespace up to
+ * the scanners of a C-like language, which is the configuration of most
+ * Obelix parsers. Each one adds to the previous one.
+ */
+
+#define ENUMERATE_SCANNER_CONFIGS(S) \
+    S(IdentifiersOnly)               \
+    S(WithKeywords)                  \
+    S(WithComments)                  \
+    S(Full)
+
+enum class ScannerConfig {
+#undef _SCANNER_CONFIG
+#define _SCANNER_CONFIG(config) config,
+    ENUMERATE_SCANNER_CONFIGS(_SCANNER_CONFIG)
+#undef _SCANNER_CONFIG
+};
+
+static void configure(Lexer& lexer, ScannerConfig config, LexerEngine engine)
+{
+    lexer.engine(engine);
+    lexer.add_scanner<IdentifierScanner>();
+    lexer.add_scanner<WhitespaceScanner>();
+    if (config == ScannerConfig::IdentifiersOnly)
+        return;
+    lexer.add_scanner<KeywordScanner>(
+        TokenCode::Keyword0, "if", TokenCode::Keyword1, "else", TokenCode::Keyword2, "while",
+        TokenCode::Keyword3, "for", TokenCode::Keyword4, "return", TokenCode::Keyword5, "continue",
+        TokenCode::Keyword6, "struct", TokenCode::Keyword7, "typedef", TokenCode::Keyword8, "static",
+        TokenCode::EqualsTo, TokenCode::NotEqualTo, TokenCode::LessEqualThan, TokenCode::GreaterEqualThan,
+        TokenCode::LogicalAnd, TokenCode::LogicalOr, TokenCode::UnaryIncrement, TokenCode::UnaryDecrement,
+        TokenCode::Keyword9, "->", TokenCode::Keyword10, "+=");
+    if (config == ScannerConfig::WithKeywords)
+        return;
+    lexer.add_scanner<CommentScanner>(
+        CommentScanner::CommentMarker { false, false, "/*", "*/" },
+        CommentScanner::CommentMarker { false, true, "//", "" },
+        CommentScanner::CommentMarker { true, true, "#", "" });
+    if (config == ScannerConfig::WithComments)
+        return;
+    lexer.add_scanner<QStringScanner>("\"'");
+    lexer.add_scanner<NumberScanner>(NumberScanner::Config { true, false, true, false, true });
+}
+
+static void report(benchmark::State& state, size_t bytes, size_t tokens)
+{
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    state.counters["tokens/s"] = benchmark::Counter(static_cast<double>(state.iterations() * tokens), benchmark::Counter::kIsRate);
+}
+
+static void BM_Tokenize(benchmark::State& state, Corpus c, ScannerConfig config, LexerEngine engine)
+{
+    auto const& text = corpus(c, static_cast<size_t>(state.range(0)));
+    Lexer lexer;
+    configure(lexer, config, engine);
+    size_t tokens = 0;
+    for (auto _ : state) {
+        tokens = lexer.tokenize(text.c_str()).size();
+        benchmark::DoNotOptimize(tokens);
+    }
+    report(state, text.length(), tokens);
+}
+
+static void BM_ParserLex(benchmark::State& state, Corpus c, ScannerConfig config, LexerEngine engine)
+{
+    auto const& text = corpus(c, static_cast<size_t>(state.range(0)));
+    BasicParser parser;
+    configure(parser.lexer(), config, engine);
+    size_t tokens = 0;
+    for (auto _ : state) {
+        parser.assign(std::string_view(text));
+        for (tokens = 1; parser.lex().code() != TokenCode::EndOfFile; ++tokens)
+            ;
+    }
+    report(state, text.length(), tokens);
+}
+
+static void BM_ParserPeek(benchmark::State& state, Corpus c, ScannerConfig config, LexerEngine engine)
+{
+    auto const& text = corpus(c, static_cast<size_t>(state.range(0)));
+    BasicParser parser;
+    configure(parser.lexer(), config, engine);
+    size_t tokens = 0;
+    for (auto _ : state) {
+        parser.assign(std::string_view(text));
+        for (tokens = 1; parser.peek().code() != TokenCode::EndOfFile; ++tokens) {
+            benchmark::DoNotOptimize(parser.current_code());
+            parser.lex();
+        }
+    }
+    report(state, text.length(), tokens);
+}
+
+/*
+ * Every benchmark runs for every corpus, scanner configuration and engine,
+ * on 1 KB to 100 MB of text. Use --benchmark_filter to select, for example,
+ * --benchmark_filter='BM_Tokenize/Mixed/Full/.*\/1024$'.
+ */
+static int register_benchmarks()
+{
+    static constexpr std::pair<char const*, Corpus> corpora[] = {
+#undef _CORPUS
+#define _CORPUS(corpus) { #corpus, Corpus::corpus },
+        ENUMERATE_CORPORA(_CORPUS)
+#undef _CORPUS
+    };
+    static constexpr std::pair<char const*, ScannerConfig> configs[] = {
+#undef _SCANNER_CONFIG
+#define _SCANNER_CONFIG(config) { #config, ScannerConfig::config },
+        ENUMERATE_SCANNER_CONFIGS(_SCANNER_CONFIG)
+#undef _SCANNER_CONFIG
+    };
+    static constexpr std::pair<char const*, LexerEngine> engines[] = {
+        { "Scanners", LexerEngine::Scanners },
+        { "Dfa", LexerEngine::Dfa },
+    };
+    static constexpr std::pair<char const*, void (*)(benchmark::State&, Corpus, ScannerConfig, LexerEngine)> benchmarks[] = {
+        { "BM_Tokenize", BM_Tokenize },
+        { "BM_ParserLex", BM_ParserLex },
+        { "BM_ParserPeek", BM_ParserPeek },
+    };
+    for (auto const& [benchmark_name, fnc] : benchmarks) {
+        for (auto const& [corpus_name, c] : corpora) {
+            for (auto const& [config_name, config] : configs) {
+                for (auto const& [engine_name, engine] : engines) {
+                    benchmark::RegisterBenchmark(format("{}/{}/{}/{}", benchmark_name, corpus_name, config_name, engine_name).c_str(), fnc, c, config, engine)
+                        ->RangeMultiplier(10)
+                        ->Range(1 << 10, 100 << 20)
+                        ->Unit(benchmark::kMillisecond);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+[[maybe_unused]] static int s_registered = register_benchmarks();
+
+}
@@ -0,0 +1,89 @@
+/*
+ * A C-like source file used as the mixed corpus of the lexer benchmarks.
+ * It is repeated as often as needed to reach the size of a benchmark run.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BUFFER_SIZE 4096
+#define MAX_ITEMS 0x400
+
+typedef struct item {
+    char const* name;
+    long value;
+    double weight;
+    struct item* next;
+} item_t;
+
+static item_t* s_items = NULL;
+static size_t s_count = 0;
+
+// Allocate an item and link it into the list.
+item_t* item_create(char const* name, long value, double weight)
+{
+    item_t* ret = (item_t*) malloc(sizeof(item_t));
+    if (ret == NULL) {
+        fprintf(stderr, "Out of memory allocating item '%s'\n", name);
+        return NULL;
+    }
+    ret->name = name;
+    ret->value = value;
+    ret->weight = weight * 1.5e-3;
+    ret->next = s_items;
+    s_items = ret;
+    ++s_count;
+    return ret;
+}
+
+/*
+ * Sum the values of all items with a weight over the threshold. Items
+ * with a negative value are skipped.
+ */
+long item_sum(double threshold)
+{
+    long sum = 0;
+    for (item_t* item = s_items; item != NULL; item = item->next) {
+        if (item->value < 0 || item->weight <= threshold)
+            continue;
+        sum += item->value;
+    }
+    return sum;
+}
+
+int item_compare(void const* a, void const* b)
+{
+    item_t const* lhs = *(item_t const**) a;
+    item_t const* rhs = *(item_t const**) b;
+    return (lhs->value > rhs->value) - (lhs->value < rhs->value);
+}
+
+void item_dump(FILE* out)
+{
+    item_t* sorted[MAX_ITEMS];
+    size_t n = 0;
+    for (item_t* item = s_items; item != NULL && n < MAX_ITEMS; item = item->next)
+        sorted[n++] = item;
+    qsort(sorted, n, sizeof(item_t*), item_compare);
+    for (size_t ix = 0; ix < n; ++ix) {
+        fprintf(out, "%-20s %8ld %10.3f\t\"%s\"\n", sorted[ix]->name,
+            sorted[ix]->value, sorted[ix]->weight, (ix % 2) ? "odd" : "even");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    char buffer[BUFFER_SIZE];
+    int lineno = 0;
+
+    while (fgets(buffer, BUFFER_SIZE, stdin) != NULL) {
+        lineno++;
+        if (buffer[0] == '#' || buffer[0] == '\n')
+            continue; // Comments and empty lines
+        item_create(strdup(buffer), lineno * 42, 3.14159 / (lineno + 1));
+    }
+    if (argc > 1 && argv[1][0] == '-')
+        item_dump(stdout);
+    printf("Sum: %ld, count: %zu\n", item_sum(0.25), s_count);
+    return (s_count > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -113,4 +113,31 @@ R"(/*
     EXPECT_EQ(count_tokens_with_code(TokenCode::Comment), 5);
 }
 
+TEST_F(CommentTest, LongComment) {
+    auto body = std::string(500, 'x') + " * / ** /";
+    tokenize("Before /*" + body + "*/ After");
+    EXPECT_EQ(lexer.tokens().size(), 6);
+    EXPECT_EQ(count_tokens_with_code(TokenCode::Comment), 1);
+    EXPECT_EQ(lexer.tokens()[2].value(), "/*" + body + "*/");
+}
+
+TEST_F(CommentTest, UnterminatedComment) {
+    tokenize("Before /*" + std::string(100, 'x') + " *");
+    EXPECT_EQ(lexer.tokens().size(), 4);
+    EXPECT_EQ(lexer.tokens()[2].code(), TokenCode::Error);
+    EXPECT_EQ(lexer.tokens()[2].value(), "Unterminated comment");
+    EXPECT_EQ(lexer.tokens()[2].location().end.column, 112);
+}
+
+TEST_F(CommentTestSplitLines, SplitCRLF) {
+    tokenize("/*" + std::string(100, 'x') + "\r\n" + std::string(100, 'y') + "*\r*/");
+    EXPECT_EQ(lexer.tokens().size(), 6);
+    EXPECT_EQ(count_tokens_with_code(TokenCode::NewLine), 2);
+    EXPECT_EQ(count_tokens_with_code(TokenCode::Comment), 3);
+    EXPECT_EQ(lexer.tokens()[0].value(), "/*" + std::string(100, 'x'));
+    EXPECT_EQ(lexer.tokens()[1].value(), "\n");
+    EXPECT_EQ(lexer.tokens()[2].value(), std::string(100, 'y') + "*");
+    EXPECT_EQ(lexer.tokens()[4].value(), "*/");
+}
+
 }
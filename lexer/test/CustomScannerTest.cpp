@@ -46,3 +46,42 @@ Line 4)");
     EXPECT_EQ(tokens[5].value(), "Line 4");
     EXPECT_EQ(tokens[6].code(), TokenCode::EndOfFile);
 }
+
+TEST(CustomScannerTest, BulkScans)
+{
+    static ByteClass const digits = ByteClass::matching(isdigit);
+    Lexer lexer {};
+    lexer.add_scanner("bulk", [](Tokenizer& tokenizer) {
+        switch (tokenizer.peek()) {
+        case '<':
+            // A quoted run: the quotes are dropped, so the token is rewritten.
+            if (tokenizer.peek(1) != '<')
+                break;
+            tokenizer.discard();
+            tokenizer.discard();
+            EXPECT_EQ(tokenizer.find(">>"), "quoted 12 text");
+            tokenizer.discard();
+            tokenizer.discard();
+            tokenizer.accept(TokenCode::DoubleQuotedString);
+            break;
+        case ' ':
+            EXPECT_EQ(tokenizer.advance(10), std::string(3, ' '));
+            tokenizer.accept(TokenCode::Whitespace);
+            break;
+        default:
+            if (!isdigit(tokenizer.peek()))
+                break;
+            (void) tokenizer.scan_while(digits);
+            tokenizer.accept(TokenCode::Integer);
+            break;
+        }
+    });
+    auto tokens = lexer.tokenize("<<quoted 12 text>>12345   ");
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[0].code(), TokenCode::DoubleQuotedString);
+    EXPECT_EQ(tokens[0].value(), "quoted 12 text");
+    EXPECT_EQ(tokens[1].code(), TokenCode::Integer);
+    EXPECT_EQ(tokens[1].value(), "12345");
+    EXPECT_EQ(tokens[2].code(), TokenCode::Whitespace);
+    EXPECT_EQ(tokens[3].code(), TokenCode::EndOfFile);
+}
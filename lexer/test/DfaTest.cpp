@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <algorithm>
+#include <random>
+
+#include <gtest/gtest.h>
+#include <lexer/Lexer.h>
+#include <lexer/LexerDfa.h>
+#include <lexer/Tokenizer.h>
+
+namespace Obelix {
+
+class DfaTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        dfa_lexer.engine(LexerEngine::Dfa);
+    }
+
+    template<class ScannerClass, class... Args>
+    void add_scanner(Args const&... args)
+    {
+        scanners_lexer.add_scanner<ScannerClass>(args...);
+        dfa_lexer.add_scanner<ScannerClass>(args...);
+        scanners.push_back(std::make_shared<ScannerClass>(args...));
+    }
+
+    [[nodiscard]] bool compiles()
+    {
+        std::sort(scanners.begin(), scanners.end(), [](auto const& a, auto const& b) { return *a < *b; });
+        return LexerDfa::compile(scanners) != nullptr;
+    }
+
+    void check(std::string const& text)
+    {
+        auto expected = scanners_lexer.tokenize(text.c_str());
+        auto tokens = dfa_lexer.tokenize(text.c_str());
+        ASSERT_EQ(tokens.size(), expected.size()) << "Input: '" << text << "'";
+        for (auto ix = 0u; ix < tokens.size(); ++ix) {
+            EXPECT_EQ(tokens[ix].code_name(), expected[ix].code_name()) << "Input: '" << text << "' token " << ix;
+            EXPECT_EQ(tokens[ix].value(), expected[ix].value()) << "Input: '" << text << "' token " << ix;
+            EXPECT_EQ(tokens[ix].location().start.index, expected[ix].location().start.index) << "Input: '" << text << "' token " << ix;
+            EXPECT_EQ(tokens[ix].location().end.index, expected[ix].location().end.index) << "Input: '" << text << "' token " << ix;
+            EXPECT_EQ(tokens[ix].location().to_string(), expected[ix].location().to_string()) << "Input: '" << text << "' token " << ix;
+        }
+    }
+
+    void check_random(std::string const& alphabet, size_t count = 500)
+    {
+        std::mt19937 rng(42);
+        std::uniform_int_distribution<size_t> length(0, 24);
+        std::uniform_int_distribution<size_t> pick(0, alphabet.length() - 1);
+        for (auto ix = 0u; ix < count; ++ix) {
+            std::string text;
+            for (auto len = length(rng); len > 0; --len)
+                text += alphabet[pick(rng)];
+            check(text);
+        }
+    }
+
+    Lexer scanners_lexer {};
+    Lexer dfa_lexer {};
+    std::vector<std::shared_ptr<Scanner>> scanners {};
+};
+
+TEST_F(DfaTest, Defaults)
+{
+    add_scanner<QStringScanner>();
+    add_scanner<NumberScanner>();
+    add_scanner<IdentifierScanner>();
+    add_scanner<WhitespaceScanner>();
+    EXPECT_TRUE(compiles());
+    check("1 + 2 + a");
+    check("Hello 'single quotes' `backticks` \"double quotes\" World");
+    check("'esc\\'aped' 'unclosed");
+    check("0..10 007 0x1F 1.5e10 1e 1.e5 -.5 +x 0.");
+    check_random("ab_Z09.+-xe$'\"`\\ \t\r\n;");
+}
+
+TEST_F(DfaTest, Whitespace)
+{
+    for (auto ignore_newlines : { false, true }) {
+        for (auto ignore_spaces : { false, true }) {
+            for (auto newlines_are_spaces : { false, true }) {
+                scanners_lexer = Lexer();
+                dfa_lexer = Lexer();
+                dfa_lexer.engine(LexerEngine::Dfa);
+                scanners.clear();
+                add_scanner<IdentifierScanner>();
+                add_scanner<WhitespaceScanner>(WhitespaceScanner::Config { ignore_newlines, ignore_spaces, newlines_are_spaces });
+                EXPECT_TRUE(compiles());
+                check(" Hello  World\nSecond Line \r\n Third Line\r\rX \r");
+                check_random("ab \t\r\n\v", 200);
+            }
+        }
+    }
+}
+
+TEST_F(DfaTest, Keywords)
+{
+    add_scanner<IdentifierScanner>();
+    add_scanner<WhitespaceScanner>(WhitespaceScanner::Config { false, false });
+    add_scanner<KeywordScanner>(
+        TokenCode::Keyword0, "for",
+        TokenCode::Keyword1, "format",
+        TokenCode::Keyword2, "font",
+        TokenCode::GreaterEqualThan,
+        TokenCode::ShiftLeft,
+        TokenCode::Keyword3, "..",
+        TokenCode::Keyword4, "...");
+    EXPECT_TRUE(compiles());
+    check("xxx for format font fo formatting >=xxx form");
+    check("for");
+    check("<<<= . .. ... .... fon");
+    check_random("fortma<>=. _");
+}
+
+TEST_F(DfaTest, CaseInsensitiveKeywords)
+{
+    add_scanner<IdentifierScanner>(IdentifierScanner::Config { TokenCode::Identifier, "X9_", "X_", IdentifierScanner::IdentifierCharacterClass::FoldToUpper });
+    add_scanner<WhitespaceScanner>();
+    add_scanner<KeywordScanner>(false, TokenCode::Keyword0, "begin", TokenCode::Keyword1, "end");
+    EXPECT_TRUE(compiles());
+    check("BEGIN begin Begin beginning END enD x Xy");
+    check_random("beginBEGINxyz ");
+}
+
+TEST_F(DfaTest, Comments)
+{
+    add_scanner<IdentifierScanner>();
+    add_scanner<WhitespaceScanner>(WhitespaceScanner::Config { false, false });
+    add_scanner<CommentScanner>(
+        CommentScanner::CommentMarker { false, false, "/*", "*/" },
+        CommentScanner::CommentMarker { false, true, "//", "" },
+        CommentScanner::CommentMarker { true, true, "#", "" });
+    EXPECT_TRUE(compiles());
+    check("#!/bin/sh\nBefore/Comment /* comment /*/ After // eol\n# not a comment");
+    check("/* unterminated");
+    check("a **/ b /* **/ c */");
+    check_random("/*#ab \n");
+}
+
+TEST_F(DfaTest, FallbackWithCustomScanner)
+{
+    add_scanner<IdentifierScanner>();
+    add_scanner<WhitespaceScanner>();
+    scanners_lexer.add_scanner("at", [](Tokenizer& tokenizer) {
+        if (tokenizer.peek() == '@') {
+            tokenizer.push();
+            tokenizer.accept(TokenCode::Keyword0);
+        }
+    });
+    dfa_lexer.add_scanner("at", [](Tokenizer& tokenizer) {
+        if (tokenizer.peek() == '@') {
+            tokenizer.push();
+            tokenizer.accept(TokenCode::Keyword0);
+        }
+    });
+    check("abc @ def@ghi");
+}
+
+TEST_F(DfaTest, SplitCommentsFallBack)
+{
+    add_scanner<IdentifierScanner>();
+    add_scanner<WhitespaceScanner>(WhitespaceScanner::Config { false, false, false });
+    add_scanner<CommentScanner>(true, CommentScanner::CommentMarker { false, false, "/*", "*/" });
+    EXPECT_FALSE(compiles());
+    check("/*\n * Multi\n * line\n */\nX\n");
+}
+
+}
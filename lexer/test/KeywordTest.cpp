@@ -191,4 +191,65 @@ TEST_F(KeywordTest, keyword_for_format)
     EXPECT_EQ(tokens_by_code[Obelix::TokenCode::Whitespace].size(), 7);
 }
 
+TEST_F(KeywordTest, keyword_operator_prefixes)
+{
+    initialize();
+    add_scanner<Obelix::KeywordScanner>(
+        TokenCode::LessEqualThan,
+        TokenCode::ShiftLeft,
+        TokenCode::Keyword0, "<<=",
+        TokenCode::Keyword1, "<=>");
+
+    tokenize("a<<=b<=c<<d<=>e");
+    EXPECT_EQ(lexer.tokens().size(), 10);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword0].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword1].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::LessEqualThan].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::ShiftLeft].size(), 1);
+    EXPECT_EQ(tokens_by_code[Obelix::TokenCode::Identifier].size(), 5);
+}
+
+TEST_F(KeywordTest, keyword_case_insensitive)
+{
+    initialize();
+    add_scanner<Obelix::KeywordScanner>(false,
+        TokenCode::Keyword0, "begin",
+        TokenCode::Keyword1, "end");
+
+    tokenize("BEGIN begin Begin beginning END enD");
+    EXPECT_EQ(lexer.tokens().size(), 12);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword0].size(), 3);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword1].size(), 2);
+    EXPECT_EQ(tokens_by_code[Obelix::TokenCode::Identifier].size(), 1);
+}
+
+TEST_F(KeywordTest, keyword_added_after_tokenize)
+{
+    initialize();
+    auto scanner = add_scanner<Obelix::KeywordScanner>(TokenCode::Keyword0, "for");
+    tokenize("for format");
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword0].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword1].size(), 0);
+
+    scanner->add_keyword(TokenCode::Keyword1, "format");
+    tokens_by_code.clear();
+    tokenize("for format");
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword0].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword1].size(), 1);
+}
+
+TEST_F(KeywordTest, keyword_with_new_start_byte_added_after_tokenize)
+{
+    initialize();
+    auto scanner = add_scanner<Obelix::KeywordScanner>(TokenCode::Keyword0, "for");
+    tokenize("for x");
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword0].size(), 1);
+
+    scanner->add_keyword(TokenCode::Keyword1, "while");
+    tokens_by_code.clear();
+    tokenize("while x");
+    EXPECT_EQ(lexer.tokens()[0].code(), TokenCode::Keyword1);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword1].size(), 1);
+}
+
 }
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <gtest/gtest.h>
+#include <lexer/test/LexerPoolTest.h>
+
+/*
+ * Count the allocations done through the global operator new, which is what
+ * the containers in the Lexer use. This replaces operator new for the whole
+ * executable, which is why these tests aren't part of LexerTest.
+ */
+static std::atomic<size_t> s_allocations { 0 };
+
+void* operator new(size_t size)
+{
+    ++s_allocations;
+    if (auto ret = malloc(size); ret != nullptr)
+        return ret;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::nothrow_t const&) noexcept
+{
+    ++s_allocations;
+    return malloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+TEST(LexerPoolTest, WarmLexerDoesNotAllocate)
+{
+    Obelix::LexerPool pool(pool_test_spec());
+    char const* text = "if x = 'a \\'string\\'' /* a\ncomment */ else 3.14 + 0x1F\n";
+    auto cold = s_allocations.load();
+    {
+        auto lexer = pool.acquire();
+        for (auto ix = 0; ix < 3; ++ix)
+            (void)lexer->tokenize(text);
+    }
+    EXPECT_GT(s_allocations.load(), cold);
+    for (auto ix = 0; ix < 10; ++ix) {
+        auto before = s_allocations.load();
+        size_t count;
+        {
+            auto lexer = pool.acquire();
+            count = lexer->tokenize(text).size();
+        }
+        EXPECT_EQ(s_allocations.load(), before);
+        EXPECT_GT(count, 10);
+    }
+}
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gtest/gtest.h>
+#include <lexer/test/LexerPoolTest.h>
+
+TEST(LexerPoolTest, ReusesLexers)
+{
+    Obelix::LexerPool pool(pool_test_spec());
+    EXPECT_EQ(pool.idle(), 0);
+    {
+        auto lexer = pool.acquire();
+        EXPECT_EQ(pool.acquired(), 1);
+        auto const& tokens = lexer->tokenize("if x else 'y'");
+        EXPECT_EQ(tokens.size(), 5);
+    }
+    EXPECT_EQ(pool.idle(), 1);
+    EXPECT_EQ(pool.acquired(), 0);
+    auto lexer = pool.acquire();
+    EXPECT_EQ(pool.idle(), 0);
+    auto const& tokens = lexer->tokenize("42 /* unterminated\ncomment");
+    EXPECT_EQ(tokens[0].value(), "42");
+
+    // The comment scanner was locked when the previous text ended:
+    auto const& next = lexer->tokenize("/ 2 /* comment */");
+    ASSERT_EQ(next.size(), 4);
+    EXPECT_EQ(next[0].code(), Obelix::TokenCode::Slash);
+    EXPECT_EQ(next[1].value(), "2");
+    EXPECT_EQ(next[2].code(), Obelix::TokenCode::Comment);
+}
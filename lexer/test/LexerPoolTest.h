@@ -0,0 +1,21 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#pragma once
+
+#include <lexer/LexerPool.h>
+
+inline std::shared_ptr<Obelix::LexerSpec const> pool_test_spec()
+{
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<Obelix::QStringScanner>();
+    lexer.add_scanner<Obelix::NumberScanner>();
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    lexer.add_scanner<Obelix::KeywordScanner>(Obelix::TokenCode::Keyword0, "if", Obelix::TokenCode::Keyword1, "else");
+    lexer.add_scanner<Obelix::CommentScanner>(true, Obelix::CommentScanner::CommentMarker { false, false, "/*", "*/" });
+    return lexer.spec();
+}
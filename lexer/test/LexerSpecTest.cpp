@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <lexer/test/LexerTest.h>
+
+TEST(LexerSpecTest, KeywordTriesAreBuiltOnce)
+{
+    Obelix::Lexer configured {};
+    auto keywords = configured.add_scanner<Obelix::KeywordScanner>(Obelix::TokenCode::Keyword0, "if", Obelix::TokenCode::Keyword1, "else");
+    configured.add_scanner<Obelix::IdentifierScanner>();
+    configured.add_scanner<Obelix::WhitespaceScanner>();
+    EXPECT_FALSE(keywords->frozen());
+    auto spec = configured.spec();
+    EXPECT_FALSE(keywords->frozen());
+
+    // Copies of the spec's scanners come with the trie:
+    for (auto const& scanner : spec->instantiate_scanners()) {
+        if (auto keyword_scanner = std::dynamic_pointer_cast<Obelix::KeywordScanner>(scanner); keyword_scanner != nullptr) {
+            EXPECT_TRUE(keyword_scanner->frozen());
+        }
+    }
+    Obelix::Lexer lexer(spec);
+    auto const& tokens = lexer.tokenize("if x else");
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[0].code(), Obelix::TokenCode::Keyword0);
+    EXPECT_EQ(tokens[2].code(), Obelix::TokenCode::Keyword1);
+}
+
+TEST(LexerSpecTest, LexersFromSpec)
+{
+    constexpr char const* text = "if x = 'str' /* comment\nspanning */ else 42\n";
+    for (auto engine : { Obelix::LexerEngine::Scanners, Obelix::LexerEngine::Dfa }) {
+        Obelix::Lexer configured {};
+        add_common_scanners(configured, true);
+        configured.engine(engine);
+        auto spec = configured.spec();
+        EXPECT_EQ(spec->engine(), engine);
+        auto const& expected = configured.tokenize(text);
+
+        // Reconfiguring the original Lexer doesn't change the spec:
+        configured.filter_codes(Obelix::TokenCode::Identifier);
+
+        std::vector<std::thread> threads;
+        std::atomic<int> mismatches { 0 };
+        for (auto ix = 0; ix < 4; ++ix) {
+            threads.emplace_back([&spec, &expected, &mismatches, text]() {
+                for (auto run = 0; run < 50; ++run) {
+                    Obelix::Lexer lexer(spec);
+                    auto const& tokens = lexer.tokenize(text);
+                    if (tokens.size() != expected.size()) {
+                        ++mismatches;
+                        continue;
+                    }
+                    for (auto t = 0u; t < tokens.size(); ++t) {
+                        if (tokens[t].code() != expected[t].code() || tokens[t].value() != expected[t].value())
+                            ++mismatches;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        EXPECT_EQ(mismatches, 0);
+    }
+}
@@ -87,3 +87,143 @@ TEST_F(LexerTest, lexer_lex)
         Obelix::TokenCode::EndOfFile);
     EXPECT_EQ(lexer.tokens()[8].value(), "a");
 }
+
+TEST(ScannerTest, StartCharacters)
+{
+    EXPECT_TRUE(Obelix::NumberScanner().start_characters().test('7'));
+    EXPECT_TRUE(Obelix::NumberScanner().start_characters().test('-'));
+    EXPECT_FALSE(Obelix::NumberScanner().start_characters().test('x'));
+    EXPECT_TRUE(Obelix::IdentifierScanner().start_characters().test('_'));
+    EXPECT_FALSE(Obelix::IdentifierScanner().start_characters().test('7'));
+    EXPECT_TRUE(Obelix::WhitespaceScanner().start_characters().test('\r'));
+    EXPECT_EQ(Obelix::QStringScanner().start_characters().count(), 3);
+    EXPECT_TRUE(Obelix::KeywordScanner(false, Obelix::TokenCode::Keyword0, "for").start_characters().test('f'));
+    EXPECT_TRUE(Obelix::KeywordScanner(false, Obelix::TokenCode::Keyword0, "for").start_characters().test('F'));
+    EXPECT_FALSE(Obelix::KeywordScanner(Obelix::TokenCode::Keyword0, "for").start_characters().test('F'));
+    EXPECT_TRUE(Obelix::CommentScanner("//").start_characters().test('/'));
+    EXPECT_EQ(Obelix::CommentScanner("//").start_characters().count(), 1);
+}
+
+TEST(ScannerTest, LowPriorityScannerStillDispatched)
+{
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner("at", [](Obelix::Tokenizer& tokenizer) {
+        if (tokenizer.peek() == '@') {
+            tokenizer.push();
+            tokenizer.accept(Obelix::TokenCode::Keyword0);
+        }
+    }, 50);
+    auto tokens = lexer.tokenize("abc@def");
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[0].code(), Obelix::TokenCode::Identifier);
+    EXPECT_EQ(tokens[1].code(), Obelix::TokenCode::Keyword0);
+    EXPECT_EQ(tokens[2].code(), Obelix::TokenCode::Identifier);
+}
+
+TEST(ScannerTest, IdentifierConfig)
+{
+    using Obelix::IdentifierScanner;
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<IdentifierScanner>(IdentifierScanner::Config {
+        Obelix::TokenCode::Identifier, "X9_$", "X$", IdentifierScanner::IdentifierCharacterClass::FoldToLower });
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    auto tokens = lexer.tokenize("$Abc_1 lower _x 9z");
+    ASSERT_EQ(tokens.size(), 7);
+    EXPECT_EQ(tokens[0].value(), "$abc_1");
+    EXPECT_EQ(tokens[1].value(), "lower");
+    EXPECT_EQ(tokens[2].code(), Obelix::TokenCode::UnderScore);
+    EXPECT_EQ(tokens[3].value(), "x");
+    EXPECT_EQ(tokens[5].value(), "z");
+}
+
+TEST(ScannerTest, IdentifierOnlyUpper)
+{
+    using Obelix::IdentifierScanner;
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<IdentifierScanner>(IdentifierScanner::Config {
+        Obelix::TokenCode::Identifier, "A9_", "A", IdentifierScanner::IdentifierCharacterClass::OnlyUpper, IdentifierScanner::IdentifierCharacterClass::OnlyUpper });
+    auto tokens = lexer.tokenize("ABC_9def");
+    ASSERT_EQ(tokens.size(), 5);
+    EXPECT_EQ(tokens[0].value(), "ABC_9");
+    EXPECT_EQ(tokens[1].code(), Obelix::TokenCode::Unknown);
+}
+
+TEST(TokenTest, RewrittenTextOutlivesScratchSpace)
+{
+    static_assert(std::is_trivially_copyable_v<Obelix::Token>);
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<Obelix::QStringScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    auto text = std::string("'first\\' escape' 'a longer string with a \\' second escape' 'plain'");
+    auto const& tokens = lexer.tokenize(text.c_str());
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[0].value(), "first' escape");
+    EXPECT_EQ(tokens[1].value(), "a longer string with a ' second escape");
+    EXPECT_EQ(tokens[2].value(), "plain");
+
+    // A copy keeps its tokens when the original is retokenized:
+    auto copy = lexer;
+    lexer.tokenize("'x\\'y'");
+    EXPECT_EQ(copy.tokens()[1].value(), "a longer string with a ' second escape");
+    EXPECT_EQ(lexer.tokens()[0].value(), "x'y");
+}
+
+TEST(TokenTest, CannotBeBuiltFromString)
+{
+    static_assert(!std::is_constructible_v<Obelix::Token, Obelix::Span, Obelix::TokenCode, std::string&>);
+    static_assert(!std::is_constructible_v<Obelix::Token, Obelix::Span, Obelix::TokenCode, std::string const&>);
+    static_assert(!std::is_constructible_v<Obelix::Token, Obelix::Span, Obelix::TokenCode, std::string const&&>);
+    static_assert(!std::is_constructible_v<Obelix::Token, Obelix::Span, Obelix::TokenCode, std::string>);
+    static_assert(!std::is_constructible_v<Obelix::Token, Obelix::Span, int, std::string&>);
+
+    Obelix::StringArena arena;
+    std::string text = "scoped";
+    Obelix::Token token({}, Obelix::TokenCode::Identifier, arena.add(text));
+    text = "changed";
+    EXPECT_EQ(token.value(), "scoped");
+}
+
+TEST(TokenTest, LocationsFromOffsets)
+{
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>(Obelix::WhitespaceScanner::Config { false, false, false });
+    auto const& tokens = lexer.tokenize("first\r\n  second\rthird", "test.obl");
+    ASSERT_EQ(tokens.size(), 7);
+    EXPECT_EQ(tokens[0].start_index(), 0);
+    EXPECT_EQ(tokens[0].end_index(), 5);
+    EXPECT_EQ(tokens[3].value(), "second");
+    EXPECT_EQ(tokens[3].start_index(), 9);
+    EXPECT_EQ(tokens[3].location().to_string(), "test.obl:2:3-2:9");
+    EXPECT_EQ(tokens[5].location().to_string(), "test.obl:3:1-3:6");
+
+    Obelix::Token copy(tokens[3].location(), Obelix::TokenCode::Identifier, "copy");
+    EXPECT_EQ(copy.location(), tokens[3].location());
+}
+
+TEST(TokenTest, LexedTokensOutliveLexer)
+{
+    Obelix::Token kept;
+    {
+        Obelix::Lexer lexer {};
+        lexer.add_scanner<Obelix::IdentifierScanner>();
+        lexer.add_scanner<Obelix::WhitespaceScanner>();
+        lexer.assign("first\nsecond third", "test.obl");
+        (void)lexer.lex();
+        kept = lexer.lex();
+        lexer.assign("x y\nz", "test.obl");
+        (void)lexer.lex();
+        EXPECT_EQ(kept.location().to_string(), "test.obl:2:1-2:7");
+    }
+    EXPECT_EQ(kept.value(), "second");
+    EXPECT_EQ(kept.location().to_string(), "test.obl:2:1-2:7");
+}
+
+TEST(TokenTest, ExplicitLocation)
+{
+    Obelix::Token token(Obelix::Span("file.obl", 3, 4, 3, 9), Obelix::TokenCode::Identifier, "x");
+    EXPECT_EQ(token.location().to_string(), "file.obl:3:4-3:9");
+    token.location(Obelix::Span("other.obl", 5, 1, 6, 2));
+    EXPECT_EQ(token.location().to_string(), "other.obl:5:1-6:2");
+}
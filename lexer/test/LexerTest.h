@@ -7,10 +7,44 @@
 #pragma once
 
 #include <cstdarg>
+#include <vector>
+
 #include <gtest/gtest.h>
 #include <lexer/Lexer.h>
 #include <lexer/Tokenizer.h>
 
+/*
+ * The scanners of the tests that compare tokens lexed in different ways:
+ * strings, numbers, identifiers, whitespace with newlines as separate
+ * tokens, two keywords, and block and line comments.
+ */
+inline void add_common_scanners(Obelix::Lexer& lexer, bool split_comments)
+{
+    lexer.add_scanner<Obelix::QStringScanner>();
+    lexer.add_scanner<Obelix::NumberScanner>();
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>(Obelix::WhitespaceScanner::Config { false, true, false });
+    lexer.add_scanner<Obelix::KeywordScanner>(Obelix::TokenCode::Keyword0, "if", Obelix::TokenCode::Keyword1, "else");
+    lexer.add_scanner<Obelix::CommentScanner>(split_comments,
+        Obelix::CommentScanner::CommentMarker { false, false, "/*", "*/" },
+        Obelix::CommentScanner::CommentMarker { false, true, "//", "" });
+}
+
+/*
+ * Checks that tokens has the same tokens as expected, at the same
+ * positions.
+ */
+inline void expect_same_tokens(std::vector<Obelix::Token> const& tokens, std::vector<Obelix::Token> const& expected)
+{
+    ASSERT_EQ(tokens.size(), expected.size());
+    for (auto ix = 0u; ix < tokens.size(); ++ix) {
+        EXPECT_EQ(tokens[ix].code(), expected[ix].code());
+        EXPECT_EQ(tokens[ix].value(), expected[ix].value());
+        EXPECT_EQ(tokens[ix].start_index(), expected[ix].start_index());
+        EXPECT_EQ(tokens[ix].location().to_string(), expected[ix].location().to_string());
+    }
+}
+
 class LexerTest : public ::testing::Test {
 public:
     Obelix::Lexer lexer {};
@@ -88,3 +88,51 @@ TEST_F(NumberTest, double_period)
     EXPECT_FALSE(token2_value_or_error.is_error());
     EXPECT_EQ(token2_value_or_error.value(), 10);
 }
+
+TEST_F(NumberTest, decoded_values)
+{
+    check_number<long>("0042", 42, Obelix::TokenCode::Integer);
+    EXPECT_EQ(std::get<long>(lexer.tokens()[4].number()), 42);
+    check_number<long>("9223372036854775807", 9223372036854775807l, Obelix::TokenCode::Integer);
+    EXPECT_EQ(std::get<long>(lexer.tokens()[4].number()), 9223372036854775807l);
+    check_number<long>("0x7fffffffffffffff", 9223372036854775807l, Obelix::TokenCode::HexNumber);
+    check_number<double>(".5e3", 500.0, Obelix::TokenCode::Float);
+    EXPECT_EQ(std::get<double>(lexer.tokens()[4].number()), 500.0);
+    check_number<double>("1e-400", 0.0, Obelix::TokenCode::Float);
+}
+
+TEST_F(NumberTest, signed_values)
+{
+    for (auto engine : { Obelix::LexerEngine::Scanners, Obelix::LexerEngine::Dfa }) {
+        lexer = Obelix::Lexer();
+        lexer.engine(engine);
+        add_scanner<Obelix::NumberScanner>();
+        add_scanner<Obelix::WhitespaceScanner>();
+        tokenize("-0042 +7 -9223372036854775808 -0x10 -.5e3");
+        ASSERT_EQ(lexer.tokens().size(), 6);
+        EXPECT_EQ(std::get<long>(lexer.tokens()[0].number()), -42);
+        EXPECT_EQ(std::get<long>(lexer.tokens()[1].number()), 7);
+        EXPECT_EQ(std::get<long>(lexer.tokens()[2].number()), std::numeric_limits<long>::min());
+        EXPECT_EQ(std::get<long>(lexer.tokens()[3].number()), -16);
+        EXPECT_EQ(std::get<double>(lexer.tokens()[4].number()), -500.0);
+    }
+}
+
+TEST_F(NumberTest, out_of_range)
+{
+    for (auto engine : { Obelix::LexerEngine::Scanners, Obelix::LexerEngine::Dfa }) {
+        for (auto const* number : { "9223372036854775808", "0x10000000000000000", "00099999999999999999999", "1e400" }) {
+            lexer = Obelix::Lexer();
+            lexer.engine(engine);
+            initialize();
+            tokenize(Obelix::format("Foo = {}", number));
+            check_codes(6,
+                Obelix::TokenCode::Identifier,
+                Obelix::TokenCode::Whitespace,
+                Obelix::TokenCode::Equals,
+                Obelix::TokenCode::Whitespace,
+                Obelix::TokenCode::Error,
+                Obelix::TokenCode::EndOfFile);
+        }
+    }
+}
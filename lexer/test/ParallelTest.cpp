@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gtest/gtest.h>
+#include <lexer/test/LexerTest.h>
+
+TEST(ParallelTest, SameTokensAsSerial)
+{
+    std::string text;
+    for (auto ix = 0; ix < 400; ++ix) {
+        switch (ix % 5) {
+        case 0:
+            text += "if x" + std::to_string(ix) + " = " + std::to_string(ix * 7) + " else 3.14\n";
+            break;
+        case 1:
+            text += "/* a comment\nspanning\nlines */ y\n";
+            break;
+        case 2:
+            text += "'a string\nwith a newline' // and a line comment\n";
+            break;
+        case 3:
+            text += "\"unclosed\n";
+            break;
+        default:
+            text += "   \n\n";
+            break;
+        }
+    }
+
+    for (auto split_comments : { false, true }) {
+        Obelix::Lexer serial {};
+        add_common_scanners(serial, split_comments);
+        auto const& expected = serial.tokenize(text.c_str());
+
+        for (auto chunk_size : { 7u, 64u, 1000u }) {
+            Obelix::Lexer lexer {};
+            add_common_scanners(lexer, split_comments);
+            lexer.parallel(4, chunk_size);
+            auto const& tokens = lexer.tokenize(text.c_str());
+            expect_same_tokens(tokens, expected);
+        }
+    }
+}
+
+TEST(ParallelTest, AfterSmallText)
+{
+    std::string text;
+    for (auto ix = 0; text.length() < 400 * 1024; ++ix)
+        text += "if x" + std::to_string(ix) + " = " + std::to_string(ix * 7) + " else 'str'\n";
+
+    Obelix::Lexer fresh {};
+    add_common_scanners(fresh, false);
+    fresh.parallel(4, 1024);
+    auto const& expected = fresh.tokenize(text.c_str());
+    EXPECT_EQ(fresh.chunks(), 4);
+
+    // The tokenizer kept from the small text doesn't stop the split:
+    Obelix::Lexer lexer {};
+    add_common_scanners(lexer, false);
+    lexer.parallel(4, 1024);
+    EXPECT_EQ(lexer.tokenize("small").size(), 2);
+    EXPECT_EQ(lexer.chunks(), 1);
+    auto const& tokens = lexer.tokenize(text.c_str());
+    EXPECT_EQ(lexer.chunks(), 4);
+    expect_same_tokens(tokens, expected);
+
+    // And neither does the one kept from the split text:
+    EXPECT_EQ(lexer.tokenize("small").size(), 2);
+    EXPECT_EQ(lexer.chunks(), 1);
+    EXPECT_EQ(lexer.tokenize(text.c_str()).size(), expected.size());
+    EXPECT_EQ(lexer.chunks(), 4);
+}
+
+TEST(ParallelTest, CustomScannersRunSerially)
+{
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    lexer.add_scanner("digits", [](Obelix::Tokenizer& tokenizer) {
+        while (isdigit(tokenizer.peek()))
+            tokenizer.push();
+        if (!tokenizer.current_token().empty())
+            tokenizer.accept(Obelix::TokenCode::Integer);
+    });
+    lexer.parallel(4, 1);
+    auto const& tokens = lexer.tokenize("1\n2\n3\n4\n5\n");
+    ASSERT_EQ(tokens.size(), 6);
+    EXPECT_EQ(tokens[4].value(), "5");
+}
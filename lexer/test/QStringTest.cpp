@@ -27,7 +27,12 @@ public:
         EXPECT_EQ(lexer.tokens()[2].value(), out);
     }
 
-    void check_qstring_error(std::string const& in)
+    /*
+     * A string that runs into the end of the input is reported with the
+     * Unclosed code for its quote, so a parser can tell it apart from other
+     * errors.
+     */
+    void check_qstring_error(std::string const& in, Obelix::TokenCode code)
     {
         add_scanner<Obelix::QStringScanner>();
         add_scanner<Obelix::IdentifierScanner>();
@@ -36,7 +41,7 @@ public:
         check_codes(4,
             Obelix::TokenCode::Identifier,
             Obelix::TokenCode::Whitespace,
-            Obelix::TokenCode::Error,
+            code,
             Obelix::TokenCode::EndOfFile);
     }
 
@@ -91,7 +96,7 @@ TEST_F(QStringTest, qstring)
 
 TEST_F(QStringTest, qstring_unclosed_string)
 {
-    check_qstring_error("'no close quote");
+    check_qstring_error("'no close quote", Obelix::TokenCode::UnclosedSingleQuotedString);
 }
 
 TEST_F(QStringTest, qstring_escape_backslash)
@@ -116,7 +121,7 @@ TEST_F(QStringTest, qstring_escape_plain_char)
 
 TEST_F(QStringTest, qstring_escape_as_last_char)
 {
-    check_qstring_error("'escape \\");
+    check_qstring_error("'escape \\", Obelix::TokenCode::UnclosedSingleQuotedString);
 }
 
 TEST_F(QStringTest, qstring_verbatim)
@@ -150,3 +155,31 @@ TEST_F(QStringTest, qstring_escape_newline_verbatim)
 {
     check_qstring(R"('escaped\nnewline')", R"('escaped\nnewline')", true);
 }
+
+TEST_F(QStringTest, qstring_long)
+{
+    auto blob = std::string(100, 'x') + "\"`" + std::string(50, 'y');
+    check_qstring("'" + blob + "'", blob);
+}
+
+TEST_F(QStringTest, qstring_long_with_escapes)
+{
+    auto blob = std::string(40, 'x');
+    check_qstring("'" + blob + "\\t" + blob + "\\'" + blob + "\\\\'", blob + "\t" + blob + "'" + blob + "\\");
+}
+
+TEST_F(QStringTest, qstring_unclosed_values)
+{
+    add_scanner<Obelix::QStringScanner>();
+    auto blob = std::string(40, 'x');
+    tokenize("'" + blob);
+    check_codes(2,
+        Obelix::TokenCode::UnclosedSingleQuotedString,
+        Obelix::TokenCode::EndOfFile);
+    EXPECT_EQ(lexer.tokens()[0].value(), blob);
+    tokenize("\"" + blob + "\\n" + blob + "\\");
+    check_codes(2,
+        Obelix::TokenCode::UnclosedDoubleQuotedString,
+        Obelix::TokenCode::EndOfFile);
+    EXPECT_EQ(lexer.tokens()[0].value(), blob + "\n" + blob);
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gtest/gtest.h>
+#include <lexer/BasicParser.h>
+#include <lexer/test/LexerTest.h>
+
+TEST(SegmentedBufferTest, SameTokensAsJoinedLines)
+{
+    std::vector<std::string> lines {
+        "if x = 42 else 3.14",
+        "/* a comment",
+        "spanning",
+        "",
+        "lines */ y",
+        "'a string",
+        "with a newline' // and a line comment",
+        "'escapes \\n and a",
+        "newline' \"unclosed",
+        "   ",
+        "identifier",
+        "x",
+    };
+    std::string text;
+    for (auto const& line : lines)
+        text += ((text.empty()) ? "" : "\n") + line;
+
+    for (auto engine : { Obelix::LexerEngine::Scanners, Obelix::LexerEngine::Dfa }) {
+        for (auto split_comments : { false, true }) {
+            Obelix::BasicParser parser {};
+            Obelix::Lexer plain {};
+            add_common_scanners(plain, split_comments);
+            plain.engine(engine);
+            auto const& expected = plain.tokenize(text.c_str(), parser.file_name());
+
+            add_common_scanners(parser.lexer(), split_comments);
+            parser.lexer().engine(engine);
+            parser.borrow(lines);
+            auto const& tokens = parser.lexer().tokenize();
+            expect_same_tokens(tokens, expected);
+
+            // Tokens within a line are slices of the line:
+            EXPECT_EQ(tokens[0].value().data(), lines[0].data());
+        }
+    }
+}
+
+TEST(SegmentedBufferTest, AssignedLinesAreCopied)
+{
+    std::vector<std::string> lines { "first line", "second" };
+    Obelix::BasicParser parser {};
+    parser.lexer().add_scanner<Obelix::IdentifierScanner>();
+    parser.lexer().add_scanner<Obelix::WhitespaceScanner>();
+    parser.assign(lines);
+    auto const& tokens = parser.lexer().tokenize();
+    lines[0] = "changed text";
+    lines.clear();
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[0].value(), "first");
+    EXPECT_EQ(tokens[1].value(), "line");
+    EXPECT_EQ(tokens[2].value(), "second");
+}
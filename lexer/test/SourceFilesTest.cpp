@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <thread>
+
+#include <gtest/gtest.h>
+#include <lexer/Lexer.h>
+#include <lexer/SourceFiles.h>
+
+namespace Obelix {
+
+TEST(SourceFiles, Intern)
+{
+    auto id = SourceFiles::intern("intern_test.obl");
+    EXPECT_NE(id, SourceFiles::NoFile);
+    EXPECT_EQ(SourceFiles::intern(std::string("intern_test.obl")), id);
+    EXPECT_NE(SourceFiles::intern("intern_test_2.obl"), id);
+    EXPECT_EQ(SourceFiles::name(id), "intern_test.obl");
+    EXPECT_EQ(SourceFiles::intern(""), SourceFiles::NoFile);
+    EXPECT_EQ(SourceFiles::name(SourceFiles::NoFile), "");
+}
+
+TEST(SourceFiles, SpanFormatting)
+{
+    Span span { "span_test.obl", 1, 2, 3, 4 };
+    EXPECT_EQ(span.file_name(), "span_test.obl");
+    EXPECT_EQ(span.to_string(), "span_test.obl:1:2-3:4");
+    EXPECT_EQ(span, (Span { std::string("span_test.obl"), 1, 2, 3, 4 }));
+}
+
+TEST(SourceFiles, ConcurrentLexers)
+{
+    std::vector<std::thread> threads;
+    std::vector<std::string> results(8);
+    for (auto ix = 0u; ix < results.size(); ++ix) {
+        threads.emplace_back([ix, &results]() {
+            for (auto round = 0; round < 200; ++round) {
+                Lexer lexer;
+                lexer.add_scanner<IdentifierScanner>();
+                lexer.add_scanner<WhitespaceScanner>();
+                auto file_name = "thread_" + std::to_string(ix) + "_" + std::to_string(round % 20) + ".obl";
+                auto const& tokens = lexer.tokenize("hello world", file_name);
+                results[ix] = std::string(tokens[1].location().file_name());
+                if (results[ix] != file_name)
+                    return;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (auto ix = 0u; ix < results.size(); ++ix)
+        EXPECT_EQ(results[ix], "thread_" + std::to_string(ix) + "_19.obl");
+}
+
+}
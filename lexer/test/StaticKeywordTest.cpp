@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gtest/gtest.h>
+#include <lexer/StaticKeywordScanner.h>
+#include <lexer/test/LexerTest.h>
+
+namespace Obelix {
+
+class StaticKeywordTest : public ::LexerTest {
+protected:
+    template<class ScannerClass, class... Args>
+    void compare(char const* text, Args&&... args)
+    {
+        Lexer runtime;
+        runtime.add_scanner<IdentifierScanner>();
+        runtime.add_scanner<WhitespaceScanner>();
+        runtime.add_scanner<KeywordScanner>(std::forward<Args>(args)...);
+        auto const& expected = runtime.tokenize(text);
+
+        for (auto engine : { LexerEngine::Scanners, LexerEngine::Dfa }) {
+            Lexer lexer;
+            lexer.engine(engine);
+            lexer.add_scanner<IdentifierScanner>();
+            lexer.add_scanner<WhitespaceScanner>();
+            lexer.add_scanner<ScannerClass>();
+            auto const& tokens = lexer.tokenize(text);
+            ASSERT_EQ(tokens.size(), expected.size()) << text;
+            for (auto ix = 0u; ix < tokens.size(); ++ix) {
+                EXPECT_EQ(tokens[ix].code(), expected[ix].code()) << text << " token " << ix;
+                EXPECT_EQ(tokens[ix].value(), expected[ix].value()) << text << " token " << ix;
+            }
+        }
+    }
+};
+
+using ForFormat = StaticKeywordScanner<
+    StaticKeyword { TokenCode::Keyword0, "for" },
+    StaticKeyword { TokenCode::Keyword1, "format" },
+    StaticKeyword { TokenCode::Keyword2, "font" },
+    TokenCode::GreaterEqualThan>;
+
+TEST_F(StaticKeywordTest, for_format)
+{
+    initialize();
+    add_scanner<ForFormat>();
+
+    tokenize("xxx for format font fo formatting >=xxx form");
+    EXPECT_EQ(lexer.tokens().size(), 17);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword0].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword1].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::Keyword2].size(), 1);
+    EXPECT_EQ(tokens_by_code[TokenCode::GreaterEqualThan].size(), 1);
+    EXPECT_EQ(tokens_by_code[Obelix::TokenCode::Identifier].size(), 5);
+    EXPECT_EQ(tokens_by_code[Obelix::TokenCode::Whitespace].size(), 7);
+}
+
+TEST_F(StaticKeywordTest, same_as_runtime_scanner)
+{
+    compare<ForFormat>("xxx for format font fo formatting >=xxx form for",
+        TokenCode::Keyword0, "for",
+        TokenCode::Keyword1, "format",
+        TokenCode::Keyword2, "font",
+        TokenCode::GreaterEqualThan);
+
+    using Operators = StaticKeywordScanner<
+        TokenCode::LessEqualThan,
+        TokenCode::ShiftLeft,
+        StaticKeyword { TokenCode::Keyword0, "<<=" },
+        StaticKeyword { 200, "<=>" }>;
+    compare<Operators>("a<<=b<=c<<d<=>e<< <<",
+        TokenCode::LessEqualThan,
+        TokenCode::ShiftLeft,
+        TokenCode::Keyword0, "<<=",
+        200, "<=>");
+}
+
+TEST_F(StaticKeywordTest, case_insensitive)
+{
+    using BeginEnd = CaseInsensitiveStaticKeywordScanner<
+        StaticKeyword { TokenCode::Keyword0, "begin" },
+        StaticKeyword { TokenCode::Keyword1, "end" }>;
+    compare<BeginEnd>("BEGIN begin Begin beginning END enD endless end",
+        false,
+        TokenCode::Keyword0, "begin",
+        TokenCode::Keyword1, "end");
+}
+
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <gtest/gtest.h>
+#include <lexer/Lexer.h>
+
+/*
+ * Part of LexerTest, where these are skipped unless the lexer is built with
+ * OBL_LEXER_STATISTICS, and of LexerStatisticsTest, which is always built
+ * against a copy of the lexer with the statistics on.
+ */
+
+TEST(StatisticsTest, CountsPerScanner)
+{
+    if constexpr (!Obelix::LexerStatistics)
+        GTEST_SKIP() << "Built without OBL_LEXER_STATISTICS";
+
+    Obelix::Lexer lexer {};
+    lexer.add_scanner<Obelix::NumberScanner>();
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    lexer.tokenize("abc 12 + def");
+    auto stats = lexer.statistics();
+    EXPECT_EQ(stats.catchall, 1);
+    EXPECT_EQ(stats.scanner("identifier").successes, 2);
+    EXPECT_EQ(stats.scanner("identifier").bytes, 6);
+    EXPECT_EQ(stats.scanner("number").successes, 1);
+    EXPECT_EQ(stats.scanner("whitespace").successes, 3);
+
+    // A new text adds to the statistics, until they are reset:
+    lexer.tokenize("x");
+    EXPECT_EQ(lexer.statistics().scanner("identifier").successes, 3);
+    lexer.reset_statistics();
+    EXPECT_TRUE(lexer.statistics().scanners.empty());
+}
+
+TEST(StatisticsTest, ParallelChunksAddUp)
+{
+    if constexpr (!Obelix::LexerStatistics)
+        GTEST_SKIP() << "Built without OBL_LEXER_STATISTICS";
+
+    std::string text;
+    for (auto ix = 0; ix < 1000; ++ix)
+        text += "abc " + std::to_string(ix) + " + def\n";
+    auto configure = [](Obelix::Lexer& lexer) {
+        lexer.add_scanner<Obelix::NumberScanner>();
+        lexer.add_scanner<Obelix::IdentifierScanner>();
+        lexer.add_scanner<Obelix::WhitespaceScanner>();
+    };
+    Obelix::Lexer serial {};
+    configure(serial);
+    serial.tokenize(text.c_str());
+    Obelix::Lexer parallel {};
+    configure(parallel);
+    parallel.parallel(4, 1024);
+    parallel.tokenize(text.c_str());
+    EXPECT_EQ(parallel.chunks(), 4);
+
+    auto expected = serial.statistics();
+    auto stats = parallel.statistics();
+    EXPECT_EQ(stats.catchall, expected.catchall);
+    for (auto const* name : { "identifier", "number", "whitespace" }) {
+        EXPECT_EQ(stats.scanner(name).successes, expected.scanner(name).successes) << name;
+        EXPECT_EQ(stats.scanner(name).bytes, expected.scanner(name).bytes) << name;
+    }
+}
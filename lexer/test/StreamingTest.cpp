@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2023, Jan de Visser <jan@finiandarcy.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <core/StreamingBuffer.h>
+#include <core/test/TempFiles.h>
+#include <gtest/gtest.h>
+#include <lexer/test/LexerTest.h>
+
+TEST(StreamingTest, PullsOnlyLookahead)
+{
+    std::string text;
+    for (auto ix = 0; ix < 10000; ++ix)
+        text += "ident" + std::to_string(ix) + " ";
+
+    Obelix::Lexer eager {};
+    eager.add_scanner<Obelix::IdentifierScanner>();
+    eager.add_scanner<Obelix::WhitespaceScanner>();
+    auto const& expected = eager.tokenize(text.c_str());
+
+    Obelix::Lexer lexer {};
+    lexer.streaming(true);
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    lexer.assign(text.c_str());
+    EXPECT_EQ(lexer.peek(3).value(), "ident3");
+    EXPECT_EQ(lexer.tokens().size(), 4);
+
+    size_t max_held = 0;
+    for (auto const& token : expected) {
+        auto t = lexer.lex();
+        EXPECT_EQ(t.code(), token.code());
+        EXPECT_EQ(t.value(), token.value());
+        EXPECT_EQ(t.start_index(), token.start_index());
+        max_held = std::max(max_held, lexer.tokens().size());
+    }
+    EXPECT_EQ(lexer.peek().code(), Obelix::TokenCode::EndOfFile);
+    EXPECT_LE(max_held, Obelix::Lexer::StreamingWindow + 2);
+}
+
+TEST(StreamingTest, MarksHoldTokens)
+{
+    std::string text;
+    for (auto ix = 0; ix < 5000; ++ix)
+        text += "ident" + std::to_string(ix) + " ";
+
+    Obelix::Lexer lexer {};
+    lexer.streaming(true);
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    lexer.assign(text.c_str());
+    for (auto ix = 0; ix < 1500; ++ix)
+        (void)lexer.lex();
+    lexer.mark();
+    for (auto ix = 0; ix < 3000; ++ix)
+        (void)lexer.lex();
+    EXPECT_GE(lexer.tokens().size(), 3000);
+    lexer.rewind_to_mark();
+    EXPECT_EQ(lexer.lex().value(), "ident1500");
+    for (auto ix = 0; ix < 3000; ++ix)
+        (void)lexer.lex();
+    EXPECT_EQ(lexer.lex().value(), "ident4501");
+    EXPECT_LE(lexer.tokens().size(), Obelix::Lexer::StreamingWindow + 2);
+}
+
+class StreamingBufferTest : public TempFiles {
+};
+
+TEST_F(StreamingBufferTest, SameTokensAsStringBuffer)
+{
+    // Tokens longer than the input the Tokenizer loads up front, so that
+    // matches run into the end of the window:
+    std::string text;
+    for (auto ix = 0; ix < 40; ++ix) {
+        switch (ix % 6) {
+        case 0:
+            text += "if x" + std::to_string(ix) + " = " + std::to_string(ix * 7) + " else 3.14\r\n";
+            break;
+        case 1:
+            text += "'" + std::string(5000 + ix, 's') + "\\n" + std::string(3000, 't') + "' y\n";
+            break;
+        case 2:
+            text += "/*";
+            for (auto line = 0; line < 90; ++line)
+                text += std::string(100, 'c') + "\n";
+            text += "*/ // and a line comment\n";
+            break;
+        case 3:
+            text += std::string(4500 + ix, 'i') + std::string(6000, ' ') + "z\n";
+            break;
+        case 4:
+            text += "\"" + std::string(7000, 'u') + "\n";
+            break;
+        default:
+            text += "   \n\n";
+            break;
+        }
+    }
+    auto path = write("streaming", text);
+
+    for (auto engine : { Obelix::LexerEngine::Scanners, Obelix::LexerEngine::Dfa }) {
+        for (auto split_comments : { false, true }) {
+            Obelix::Lexer plain {};
+            add_common_scanners(plain, split_comments);
+            plain.engine(engine);
+            auto const& expected = plain.tokenize(text.c_str());
+
+            for (auto window_size : { 64u, 10000u }) {
+                auto buffer = Obelix::StreamingBuffer::from_file(path, nullptr, window_size);
+                ASSERT_FALSE(buffer.is_error());
+                Obelix::Lexer lexer {};
+                add_common_scanners(lexer, split_comments);
+                lexer.engine(engine);
+                lexer.assign(buffer.value());
+                auto const& tokens = lexer.tokenize();
+                expect_same_tokens(tokens, expected);
+                EXPECT_LT(buffer.value()->buffer().length(), 3 * 8192u);
+            }
+        }
+    }
+}
+
+TEST_F(StreamingBufferTest, StreamingUsesBoundedMemory)
+{
+    std::string text;
+    size_t lines = 50000;
+    for (auto ix = 0u; ix < lines; ++ix)
+        text += "ident" + std::to_string(ix) + " 'string " + std::to_string(ix) + "' " + std::to_string(ix) + "\n";
+    auto buffer = Obelix::StreamingBuffer::from_file(write("bounded", text), nullptr, 4096);
+    ASSERT_FALSE(buffer.is_error());
+
+    Obelix::Lexer lexer {};
+    lexer.streaming(true);
+    lexer.add_scanner<Obelix::QStringScanner>();
+    lexer.add_scanner<Obelix::NumberScanner>();
+    lexer.add_scanner<Obelix::IdentifierScanner>();
+    lexer.add_scanner<Obelix::WhitespaceScanner>();
+    lexer.assign(buffer.value());
+
+    size_t identifiers = 0;
+    size_t max_capacity = 0;
+    while (true) {
+        auto const& token = lexer.lex();
+        if (token.code() == Obelix::TokenCode::EndOfFile)
+            break;
+        if (token.code() == Obelix::TokenCode::Identifier) {
+            EXPECT_EQ(token.value(), "ident" + std::to_string(identifiers));
+            EXPECT_EQ(token.location().start.line, ++identifiers);
+            EXPECT_EQ(token.location().start.column, 1);
+        }
+        max_capacity = std::max(max_capacity, lexer.arena().capacity());
+    }
+    EXPECT_EQ(identifiers, lines);
+    EXPECT_GT(lexer.arena().size(), 0u);
+    EXPECT_LE(max_capacity, 4 * Obelix::StringArena::BlockSize);
+    EXPECT_EQ(buffer.value()->lines().line_count(), lines + 1);
+}
@@ -218,3 +218,25 @@ TEST_F(WhitespaceTest, IgnoreNoWhitespace_newlines_are_spaces)
     EXPECT_EQ(lexer.tokens()[8].value(), " \n ");
 
 }
+
+TEST_F(WhitespaceTest, LongIndentation)
+{
+    add_scanner<Obelix::IdentifierScanner>();
+    add_scanner<Obelix::WhitespaceScanner>(Obelix::WhitespaceScanner::Config { false, false, false });
+    auto indent = std::string(37, ' ') + "\t" + std::string(20, ' ');
+    tokenize("Hello\r\n" + indent + "World" + indent + "\r" + indent);
+    check_codes(8,
+        Obelix::TokenCode::Identifier,
+        Obelix::TokenCode::NewLine,
+        Obelix::TokenCode::Whitespace,
+        Obelix::TokenCode::Identifier,
+        Obelix::TokenCode::Whitespace,
+        Obelix::TokenCode::NewLine,
+        Obelix::TokenCode::Whitespace,
+        Obelix::TokenCode::EndOfFile);
+    EXPECT_EQ(lexer.tokens()[1].value(), "\n");
+    EXPECT_EQ(lexer.tokens()[2].value(), indent);
+    EXPECT_EQ(lexer.tokens()[5].value(), "\n");
+    EXPECT_EQ(lexer.tokens()[6].location().start.line, 3);
+    EXPECT_EQ(lexer.tokens()[6].location().end.column, indent.length() + 1);
+}